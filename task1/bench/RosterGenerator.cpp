@@ -0,0 +1,112 @@
+#include "RosterGenerator.h"
+
+namespace {
+
+const char* const kLastNames[] = {
+    "Ivanov", "Petrov", "Sidorov", "Smirnov", "Kuznetsov", "Popov", "Vasiliev", "Sokolov",
+    "Mikhailov", "Novikov", "Fedorov", "Morozov", "Volkov", "Alekseev", "Lebedev", "Semenov",
+    "Егоров", "Павлов", "Козлов", "Степанов", "Николаев", "Орлов", "Андреев", "Макаров"
+};
+
+const char* const kFirstNames[] = {
+    "Ivan", "Petr", "Denis", "Vladimir", "Alexey", "Sergey", "Dmitry", "Andrey",
+    "Anna", "Maria", "Elena", "Olga", "Tatiana", "Natalia", "Irina", "Svetlana",
+    "Михаил", "Никита", "Артем", "Егор", "Дарья", "Полина", "Ксения", "Алина"
+};
+
+const char* const kMiddleNames[] = {
+    "Ivanovich", "Petrovich", "Sergeevich", "Andreevich", "Dmitrievich", "Alekseevich",
+    "Ivanovna", "Petrovna", "Sergeevna", "Андреевна", "Дмитриевна", "Михайлович"
+};
+
+template<size_t N>
+QByteArray pick(QRandomGenerator& random, const char* const (&names)[N])
+{
+    return QByteArray(names[random.bounded(int(N))]);
+}
+
+} // namespace
+
+RosterGenerator::RosterGenerator(const Options& options)
+    : m_options(options)
+    , m_random(options.seed)
+{
+}
+
+QByteArray RosterGenerator::generate()
+{
+    QList<Person> people;
+    QByteArray data;
+    data.reserve(m_options.records * 40);
+    m_dates.clear();
+    m_dates.reserve(m_options.records);
+    
+    for (qsizetype i = 0; i < m_options.records; ++i) {
+        const int id = int(i + 1);
+        Person person;
+        
+        if (!people.isEmpty() && m_random.generateDouble() < m_options.duplicateRatio) {
+            person = people[m_random.bounded(int(people.size()))];
+        } else {
+            person = randomPerson();
+            people.append(person);
+        }
+        
+        QByteArray line;
+        if (m_random.generateDouble() < m_options.invalidRatio) {
+            line = invalidLine(id, person);
+        } else {
+            line = QByteArray::number(id) + ' ' + person.lastName + ' ' + person.firstName;
+            if (!person.middleName.isEmpty()) {
+                line += ' ' + person.middleName;
+            }
+            line += ' ' + person.date;
+            m_dates.append(person.date);
+        }
+        
+        data += line;
+        data += '\n';
+    }
+    
+    return data;
+}
+
+RosterGenerator::Person RosterGenerator::randomPerson()
+{
+    // Номер к фамилии дает почти уникальные ФИО при любом размере списка
+    Person person;
+    person.lastName = pick(m_random, kLastNames) + QByteArray::number(m_random.bounded(1000));
+    person.firstName = pick(m_random, kFirstNames);
+    if (m_random.generateDouble() < m_options.middleNameRatio) {
+        person.middleName = pick(m_random, kMiddleNames);
+    }
+    person.date = randomDate();
+    return person;
+}
+
+QByteArray RosterGenerator::randomDate()
+{
+    const int day = m_random.bounded(1, 29);
+    const int month = m_random.bounded(1, 13);
+    const int year = m_random.bounded(1970, 2010);
+    
+    return QByteArray::number(day).rightJustified(2, '0') + '.' +
+           QByteArray::number(month).rightJustified(2, '0') + '.' + QByteArray::number(year);
+}
+
+QByteArray RosterGenerator::invalidLine(int id, const Person& person)
+{
+    switch (m_random.bounded(3)) {
+    case 0:
+        // Несуществующая дата
+        m_dates.append("43.01.1988");
+        return QByteArray::number(id) + ' ' + person.lastName + ' ' + person.firstName + " 43.01.1988";
+    case 1:
+        // Не хватает полей
+        return QByteArray::number(id) + ' ' + person.lastName;
+    default:
+        // Нечисловой id
+        m_dates.append(person.date);
+        return "x" + QByteArray::number(id) + ' ' + person.lastName + ' ' + person.firstName + ' ' + person.date;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef ROSTERGENERATOR_H
+#define ROSTERGENERATOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QRandomGenerator>
+
+// Синтетический входной файл студентов в формате
+// "id Фамилия Имя [Отчество] dd.MM.yyyy". При одинаковых настройках
+// и зерне файл получается одинаковым.
+class RosterGenerator
+{
+public:
+    struct Options
+    {
+        qsizetype records = 100000;
+        double duplicateRatio = 0.1;
+        double middleNameRatio = 0.5;
+        double invalidRatio = 0.01;
+        quint32 seed = 1;
+    };
+    
+    explicit RosterGenerator(const Options& options);
+    
+    QByteArray generate();
+    
+    // Поле даты каждой строки последнего файла (в том числе испорченные)
+    const QList<QByteArray>& dates() const { return m_dates; }
+    
+private:
+    struct Person
+    {
+        QByteArray lastName;
+        QByteArray firstName;
+        QByteArray middleName;
+        QByteArray date;
+    };
+    
+    Person randomPerson();
+    QByteArray randomDate();
+    QByteArray invalidLine(int id, const Person& person);
+    
+    Options m_options;
+    QRandomGenerator m_random;
+    QList<QByteArray> m_dates;
+};
+
+#endif // ROSTERGENERATOR_H
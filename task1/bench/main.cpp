@@ -0,0 +1,289 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <functional>
+#include "DateDecoder.h"
+#include "RosterGenerator.h"
+#include "RosterReplica.h"
+#include "RosterView.h"
+#include "StudentManager.h"
+#include "StudentParser.h"
+#include "StudentSort.h"
+
+namespace {
+
+struct BenchResult
+{
+    QString name;
+    qsizetype records;
+    qsizetype bytes;
+    QList<qint64> samples;
+    
+    qint64 median() const
+    {
+        QList<qint64> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.at(sorted.size() / 2);
+    }
+    
+    qint64 minimum() const { return *std::min_element(samples.cbegin(), samples.cend()); }
+    
+    double perSecond(qsizetype amount) const
+    {
+        const qint64 ns = qMax<qint64>(1, median());
+        return double(amount) * 1e9 / double(ns);
+    }
+};
+
+class BenchRunner
+{
+public:
+    BenchRunner(int iterations, const QString& filter)
+        : m_iterations(qMax(1, iterations))
+        , m_filter(filter)
+    {
+    }
+    
+    // Один прогон на прогрев, затем m_iterations замеров; в отчет идет медиана
+    void run(const QString& name, qsizetype records, qsizetype bytes, const std::function<void()>& body)
+    {
+        if (!m_filter.isEmpty() && !name.contains(m_filter)) {
+            return;
+        }
+        
+        body();
+        
+        BenchResult result{name, records, bytes, {}};
+        for (int i = 0; i < m_iterations; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            body();
+            result.samples.append(timer.nsecsElapsed());
+        }
+        
+        qInfo().noquote() << QString("%1 %2 ms  %3 records/s  %4 MB/s")
+                                 .arg(name, -22)
+                                 .arg(double(result.median()) / 1e6, 9, 'f', 3)
+                                 .arg(result.perSecond(records), 14, 'f', 0)
+                                 .arg(result.perSecond(bytes) / 1e6, 9, 'f', 1);
+        m_results.append(result);
+    }
+    
+    QJsonArray toJson() const
+    {
+        QJsonArray results;
+        for (const BenchResult& result : m_results) {
+            QJsonObject entry;
+            entry.insert("name", result.name);
+            entry.insert("iterations", qint64(result.samples.size()));
+            entry.insert("records", qint64(result.records));
+            entry.insert("bytes", qint64(result.bytes));
+            entry.insert("median_ns", result.median());
+            entry.insert("min_ns", result.minimum());
+            entry.insert("records_per_sec", result.perSecond(result.records));
+            entry.insert("bytes_per_sec", result.perSecond(result.bytes));
+            results.append(entry);
+        }
+        return results;
+    }
+    
+private:
+    int m_iterations;
+    QString m_filter;
+    QList<BenchResult> m_results;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Student Pipeline Benchmark");
+    app.setApplicationVersion("1.0");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks for the task1 student pipeline stages");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    
+    QCommandLineOption recordsOption({"n", "records"}, "Number of generated input lines", "count", "100000");
+    QCommandLineOption duplicatesOption("duplicates", "Share of lines repeating an earlier student", "ratio", "0.1");
+    QCommandLineOption middleNamesOption("middle-names", "Share of students with a middle name", "ratio", "0.5");
+    QCommandLineOption invalidOption("invalid", "Share of malformed lines", "ratio", "0.01");
+    QCommandLineOption seedOption("seed", "Generator seed", "seed", "1");
+    QCommandLineOption iterationsOption({"i", "iterations"}, "Measured iterations per benchmark", "count", "5");
+    QCommandLineOption filterOption({"f", "filter"}, "Run only benchmarks whose name contains the text", "text");
+    QCommandLineOption jsonOption("json", "Write results as JSON to the file (\"-\" for stdout)", "file");
+    QCommandLineOption stringTableOption("string-table", "Serialize through a shared string table");
+    QCommandLineOption compressOption({"z", "compress"}, "Compress serialized chunks");
+    QCommandLineOption logRulesOption("log-rules", "Logging rules; by default roster logging is off", "rules");
+    parser.addOptions({recordsOption, duplicatesOption, middleNamesOption, invalidOption, seedOption,
+                       iterationsOption, filterOption, jsonOption, stringTableOption, compressOption,
+                       logRulesOption});
+    parser.process(app);
+    
+    // Предупреждения о плохих строках замерили бы вывод журнала, а не разбор
+    QLoggingCategory::setFilterRules(parser.isSet(logRulesOption)
+                                         ? parser.value(logRulesOption).replace(';', '\n')
+                                         : QString("roster.*=false"));
+    
+    RosterGenerator::Options options;
+    options.records = parser.value(recordsOption).toLongLong();
+    options.duplicateRatio = parser.value(duplicatesOption).toDouble();
+    options.middleNameRatio = parser.value(middleNamesOption).toDouble();
+    options.invalidRatio = parser.value(invalidOption).toDouble();
+    options.seed = parser.value(seedOption).toUInt();
+    
+    RosterGenerator generator(options);
+    const QByteArray input = generator.generate();
+    const qsizetype inputRecords = options.records;
+    
+    QTemporaryFile inputFile;
+    if (!inputFile.open() || inputFile.write(input) != input.size() || !inputFile.flush()) {
+        qCritical() << "Cannot write generated roster to" << inputFile.fileName();
+        return 1;
+    }
+    
+    BenchRunner runner(parser.value(iterationsOption).toInt(), parser.value(filterOption));
+    StudentParser studentParser;
+    
+    runner.run("parse_file", inputRecords, input.size(), [&]() {
+        studentParser.parseFile(inputFile.fileName());
+    });
+    
+    const QList<QByteArray> lines = input.split('\n');
+    runner.run("parse_line", inputRecords, input.size(), [&]() {
+        for (qsizetype i = 0; i < lines.size(); ++i) {
+            studentParser.parseLine(QString::fromUtf8(lines[i]), int(i + 1));
+        }
+    });
+    
+    QList<QByteArrayView> dates;
+    qsizetype dateBytes = 0;
+    for (const QByteArray& date : generator.dates()) {
+        dates.append(date);
+        dateBytes += date.size();
+    }
+    QList<qint64> days(dates.size());
+    
+    runner.run("date_decode", dates.size(), dateBytes, [&]() {
+        for (qsizetype i = 0; i < dates.size(); ++i) {
+            days[i] = DateDecoder::decode(dates[i]);
+        }
+    });
+    
+    runner.run("date_decode_column", dates.size(), dateBytes, [&]() {
+        DateDecoder::decodeColumn(dates.constData(), dates.size(), days.data());
+    });
+    
+    const StudentStore parsed = studentParser.parseFile(inputFile.fileName());
+    
+    runner.run("merge_duplicates", parsed.size(), 0, [&]() {
+        StudentManager manager;
+        manager.reloadFile("bench", parsed);
+    });
+    
+    StudentManager manager;
+    manager.setStringTableEnabled(parser.isSet(stringTableOption));
+    manager.setCompressionEnabled(parser.isSet(compressOption));
+    manager.reloadFile("bench", parsed);
+    
+    // Время должно расти почти линейно с --records
+    runner.run("near_duplicates", manager.count(), 0, [&]() {
+        manager.findNearDuplicates(1);
+    });
+    
+    QList<RosterPartition> partitions = manager.serializeStudents();
+    qsizetype encodedBytes = 0;
+    for (const RosterPartition& partition : partitions) {
+        for (const RosterChunk& chunk : partition) {
+            encodedBytes += chunk.payload.size();
+        }
+    }
+    
+    runner.run("serialize_snapshot", manager.count(), encodedBytes, [&]() {
+        partitions = manager.serializeStudents();
+    });
+    
+    // Тот же путь, что у ZmqClient: записи остаются в буферах тел, копия
+    // раздела ссылается на них
+    QList<RosterBufferPtr> bodies;
+    for (const RosterPartition& partition : std::as_const(partitions)) {
+        for (const RosterChunk& chunk : partition) {
+            bodies.append(RosterBuffer::fromBytes(chunk.payload, chunk.flags, RosterProtocol::SnapshotMessage));
+        }
+    }
+    
+    RosterReplica replica;
+    runner.run("deserialize_snapshot", manager.count(), encodedBytes, [&]() {
+        replica.clear();
+        for (const RosterBufferPtr& body : std::as_const(bodies)) {
+            replica.apply(body, RosterProtocol::SnapshotMessage);
+        }
+    });
+    
+    QList<RosterRecordView> records;
+    records.reserve(replica.size());
+    for (const RosterRecordRef& ref : replica.records()) {
+        records.append(ref.decode());
+    }
+    
+    // Как ZmqClient::emitRoster без порядка сервера: сортировка записей по байтам UTF-8
+    runner.run("client_sort_keys", manager.count(), 0, [&]() {
+        StudentSort::order(records, StudentSort::ComparisonSort);
+    });
+    
+    runner.run("client_sort_radix", manager.count(), 0, [&]() {
+        StudentSort::order(records, StudentSort::RadixSort);
+    });
+    
+    runner.run("client_sort_parallel", manager.count(), 0, [&]() {
+        StudentSort::order(records, StudentSort::ParallelRadixSort);
+    });
+    
+    // Снимок отсортирован сервером: клиент только собирает список по порядку ключей
+    runner.run("client_presorted", manager.count(), 0, [&]() {
+        QList<RosterRecordRef> refs;
+        refs.reserve(replica.order().size());
+        for (quint32 key : replica.order()) {
+            refs.append(replica.records().value(key));
+        }
+        const RosterView view(0, replica.buffers(), refs);
+    });
+    
+    if (parser.isSet(jsonOption)) {
+        QJsonObject config;
+        config.insert("records", qint64(options.records));
+        config.insert("duplicates", options.duplicateRatio);
+        config.insert("middle_names", options.middleNameRatio);
+        config.insert("invalid", options.invalidRatio);
+        config.insert("seed", qint64(options.seed));
+        config.insert("string_table", parser.isSet(stringTableOption));
+        config.insert("compress", parser.isSet(compressOption));
+        
+        QJsonObject report;
+        report.insert("config", config);
+        report.insert("qt_version", QString(qVersion()));
+        report.insert("benchmarks", runner.toJson());
+        
+        const QString path = parser.value(jsonOption);
+        QFile output(path);
+        const bool opened = path == "-" ? output.open(stdout, QIODevice::WriteOnly)
+                                        : output.open(QIODevice::WriteOnly);
+        if (!opened) {
+            qCritical() << "Cannot write results to" << path;
+            return 1;
+        }
+        output.write(QJsonDocument(report).toJson());
+    }
+    
+    return 0;
+}
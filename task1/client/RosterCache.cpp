@@ -0,0 +1,116 @@
+#include "RosterCache.h"
+#include "RosterLogging.h"
+#include <QSaveFile>
+#include <QtEndian>
+
+namespace RosterCache
+{
+
+bool save(const QString& path, const QList<Partition>& partitions)
+{
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(lcTransport) << "Cannot write roster cache" << path << ":" << file.errorString();
+        return false;
+    }
+    
+    uchar header[HeaderSize] = {};
+    qToLittleEndian<quint32>(Magic, header);
+    header[4] = FormatVersion;
+    header[5] = RosterProtocol::ProtocolVersion;
+    qToLittleEndian<quint32>(quint32(partitions.size()), header + 8);
+    file.write(reinterpret_cast<const char*>(header), HeaderSize);
+    
+    for (const Partition& partition : partitions) {
+        uchar partitionHeader[PartitionHeaderSize];
+        qToLittleEndian<quint32>(partition.index, partitionHeader);
+        qToLittleEndian<quint32>(quint32(partition.bodies.size()), partitionHeader + 4);
+        qToLittleEndian<quint64>(partition.epoch, partitionHeader + 8);
+        qToLittleEndian<quint64>(partition.version, partitionHeader + 16);
+        file.write(reinterpret_cast<const char*>(partitionHeader), PartitionHeaderSize);
+        
+        for (const RosterBufferPtr& body : partition.bodies) {
+            const QByteArrayView bytes = body->bytes();
+            uchar size[4];
+            qToLittleEndian<quint32>(quint32(bytes.size()), size);
+            file.write(reinterpret_cast<const char*>(size), sizeof(size));
+            file.write(bytes.data(), bytes.size());
+        }
+    }
+    
+    if (!file.commit()) {
+        qCWarning(lcTransport) << "Cannot write roster cache" << path << ":" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool load(const QString& path, QList<Partition>& partitions)
+{
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    const qint64 size = file->size();
+    if (size < HeaderSize) {
+        qCWarning(lcTransport) << "Roster cache" << path << "is truncated";
+        return false;
+    }
+    
+    // Отображение живет, пока открыт файл; его держат буферы тел
+    const uchar* data = file->map(0, size);
+    if (!data) {
+        qCWarning(lcTransport) << "Cannot map roster cache" << path << ":" << file->errorString();
+        return false;
+    }
+    
+    if (qFromLittleEndian<quint32>(data) != Magic || data[4] != FormatVersion ||
+        data[5] != RosterProtocol::ProtocolVersion) {
+        qCWarning(lcTransport) << "Roster cache" << path << "has another format, ignored";
+        return false;
+    }
+    
+    const quint32 count = qFromLittleEndian<quint32>(data + 8);
+    qint64 offset = HeaderSize;
+    QList<Partition> loaded;
+    
+    for (quint32 i = 0; i < count; ++i) {
+        if (size - offset < PartitionHeaderSize) {
+            qCWarning(lcTransport) << "Roster cache" << path << "is truncated";
+            return false;
+        }
+        
+        Partition partition;
+        partition.index = qFromLittleEndian<quint32>(data + offset);
+        const quint32 bodies = qFromLittleEndian<quint32>(data + offset + 4);
+        partition.epoch = qFromLittleEndian<quint64>(data + offset + 8);
+        partition.version = qFromLittleEndian<quint64>(data + offset + 16);
+        offset += PartitionHeaderSize;
+        
+        for (quint32 j = 0; j < bodies; ++j) {
+            if (size - offset < 4 || size - offset - 4 < qFromLittleEndian<quint32>(data + offset)) {
+                qCWarning(lcTransport) << "Roster cache" << path << "is truncated";
+                return false;
+            }
+            const qsizetype bodySize = qFromLittleEndian<quint32>(data + offset);
+            offset += 4;
+            
+            const RosterBufferPtr body = RosterBuffer::fromMapped(file, reinterpret_cast<const char*>(data + offset),
+                                                                  bodySize, RosterProtocol::SnapshotMessage);
+            if (!body) {
+                qCWarning(lcTransport) << "Roster cache" << path << "has a malformed body of partition" << partition.index;
+                return false;
+            }
+            partition.bodies.append(body);
+            offset += bodySize;
+        }
+        
+        loaded.append(partition);
+    }
+    
+    partitions = std::move(loaded);
+    return true;
+}
+
+} // namespace RosterCache
@@ -0,0 +1,35 @@
+#ifndef ROSTERCACHE_H
+#define ROSTERCACHE_H
+
+#include <QList>
+#include <QString>
+#include "RosterView.h"
+
+// Последний примененный снимок каждого раздела на диске. Тела снимков
+// пишутся как есть, без сжатия; при загрузке файл отображается в память
+// и записи читаются прямо из него, без копирования и повторного кодирования.
+namespace RosterCache
+{
+    // "RSTC"
+    constexpr quint32 Magic = 0x43545352;
+    constexpr quint8 FormatVersion = 2;
+    constexpr qsizetype HeaderSize = 16;
+    constexpr qsizetype PartitionHeaderSize = 24;
+    
+    // Версия подтверждается снимком сервера только вместе с эпохой
+    struct Partition
+    {
+        quint32 index = 0;
+        quint64 epoch = 0;
+        quint64 version = 0;
+        QList<RosterBufferPtr> bodies;
+    };
+    
+    // Файл заменяется атомарно, уже отображенный старый файл остается целым
+    bool save(const QString& path, const QList<Partition>& partitions);
+    
+    // Файл другого формата или версии протокола не загружается
+    bool load(const QString& path, QList<Partition>& partitions);
+}
+
+#endif // ROSTERCACHE_H
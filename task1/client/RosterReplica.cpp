@@ -0,0 +1,165 @@
+#include "RosterReplica.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+// Условия Student::isValid без создания Student
+bool isValidRecord(const RosterRecordView& record)
+{
+    return record.id > 0 && !record.firstName.isEmpty() && !record.lastName.isEmpty() &&
+           QDate::fromJulianDay(record.julianDay).isValid();
+}
+
+} // namespace
+
+RosterReplica::RosterReplica()
+    : m_snapshotBuffers(0)
+    , m_ordered(true)
+{
+}
+
+void RosterReplica::clear()
+{
+    m_records.clear();
+    m_buffers.clear();
+    m_snapshotBuffers = 0;
+    m_references.clear();
+    m_order.clear();
+    m_ordered = true;
+}
+
+void RosterReplica::mergeOrder(const QSet<quint32>& removed, const QSet<quint32>& inserted)
+{
+    // Имена ключа не меняются, пока он существует; равные ФИО упорядочены по ключу
+    const auto less = [this](quint32 left, quint32 right) {
+        const int result = RosterProtocol::compareNames(m_records.value(left).decode(), m_records.value(right).decode());
+        return result != 0 ? result < 0 : left < right;
+    };
+    
+    if (!removed.isEmpty()) {
+        const auto isRemoved = [&removed](quint32 key) { return removed.contains(key); };
+        m_order.erase(std::remove_if(m_order.begin(), m_order.end(), isRemoved), m_order.end());
+    }
+    
+    // Сортируются только новые ключи, с порядком они сливаются за линейное время
+    QList<quint32> keys(inserted.cbegin(), inserted.cend());
+    std::sort(keys.begin(), keys.end(), less);
+    
+    QList<quint32> merged(m_order.size() + keys.size());
+    std::merge(m_order.cbegin(), m_order.cend(), keys.cbegin(), keys.cend(), merged.begin(), less);
+    m_order.swap(merged);
+}
+
+bool RosterReplica::release(const RosterRecordRef& ref)
+{
+    // Записи тел снимка не считаются
+    const auto it = m_references.find(ref.buffer);
+    if (it == m_references.end() || --*it > 0) {
+        return false;
+    }
+    m_references.erase(it);
+    return true;
+}
+
+void RosterReplica::dropUnreferenced()
+{
+    const auto unreferenced = [this](const RosterBufferPtr& buffer) {
+        return !m_references.contains(buffer.get());
+    };
+    m_buffers.erase(std::remove_if(m_buffers.begin() + m_snapshotBuffers, m_buffers.end(), unreferenced),
+                    m_buffers.end());
+}
+
+bool RosterReplica::apply(const RosterBufferPtr& buffer, RosterProtocol::MessageType type)
+{
+    const bool snapshot = type == RosterProtocol::SnapshotMessage;
+    RosterReader reader = buffer->reader();
+    
+    if (snapshot) {
+        // Порядок известен, только если отсортирована каждая часть снимка
+        m_ordered = m_ordered && reader.isSorted();
+        m_records.reserve(m_records.size() + qsizetype(reader.count()));
+    }
+    if (!m_ordered) {
+        m_order.clear();
+    }
+    m_buffers.append(buffer);
+    if (snapshot) {
+        ++m_snapshotBuffers;
+    }
+    
+    // Дельта не двигает порядок по одной записи: удаленные и новые ключи
+    // собираются, и порядок перестраивается одним слиянием в конце
+    QSet<quint32> removed;
+    QSet<quint32> inserted;
+    bool released = false;
+    
+    RosterRecordView record;
+    qsizetype offset = reader.position();
+    while (reader.next(record)) {
+        const RosterRecordRef ref{buffer.get(), offset};
+        offset = reader.position();
+        
+        if (record.change == RosterProtocol::RemoveChange) {
+            ROSTER_TRACE(lcCodec) << "Remove key" << record.key;
+            const auto it = m_records.find(record.key);
+            if (it == m_records.end()) {
+                continue;
+            }
+            released = release(*it) || released;
+            m_records.erase(it);
+            // Ключ, добавленный этой же дельтой, в порядке еще не стоит
+            if (m_ordered && !inserted.remove(record.key)) {
+                removed.insert(record.key);
+            }
+            continue;
+        }
+        
+        if (!isValidRecord(record)) {
+            qCWarning(lcCodec) << "Invalid student:" << record.id << record.lastName << record.firstName;
+            continue;
+        }
+        
+        ROSTER_TRACE(lcCodec) << "Upsert key" << record.key << "id" << record.id << record.lastName << record.firstName;
+        if (!snapshot) {
+            // Сначала ссылка на новое тело: старая запись может лежать в нем же
+            ++m_references[buffer.get()];
+        }
+        
+        const auto it = m_records.find(record.key);
+        if (it != m_records.end()) {
+            released = release(*it) || released;
+            *it = ref;
+            continue;
+        }
+        
+        if (m_ordered) {
+            if (snapshot) {
+                m_order.append(record.key);
+            } else {
+                inserted.insert(record.key);
+            }
+        }
+        m_records.insert(record.key, ref);
+    }
+    
+    // Тело дельты держится, пока на него ссылается хоть одна запись
+    if (!snapshot && (released || !m_references.contains(buffer.get()))) {
+        dropUnreferenced();
+    }
+    
+    if (!removed.isEmpty() || !inserted.isEmpty()) {
+        mergeOrder(removed, inserted);
+    }
+    
+    if (!reader.isValid()) {
+        qCWarning(lcCodec) << "Malformed roster payload after" << m_records.size() << "records";
+        return false;
+    }
+    
+    RosterMetrics::add(RosterMetrics::DecodedRecords, reader.count());
+    return true;
+}
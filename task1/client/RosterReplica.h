@@ -0,0 +1,46 @@
+#ifndef ROSTERREPLICA_H
+#define ROSTERREPLICA_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include "RosterView.h"
+
+// Копия одного раздела списка поверх принятых тел сообщений: записи по ключам
+// и порядок ключей по ФИО, пока он известен. Снимок собирается в пустой копии
+// по частям, дельты применяются к собранной. Буферы тел остаются в копии,
+// записи ссылаются на них. Тела снимка закреплены в начале списка, тело
+// дельты отпускается, когда на него не ссылается ни одна живая запись.
+class RosterReplica
+{
+public:
+    RosterReplica();
+    
+    bool apply(const RosterBufferPtr& buffer, RosterProtocol::MessageType type);
+    void clear();
+    
+    const QHash<quint32, RosterRecordRef>& records() const { return m_records; }
+    const QList<RosterBufferPtr>& buffers() const { return m_buffers; }
+    qsizetype snapshotBuffers() const { return m_snapshotBuffers; }
+    qsizetype size() const { return m_records.size(); }
+    
+    // Ключи в порядке ФИО; известен, если каждая часть снимка пришла отсортированной
+    const QList<quint32>& order() const { return m_order; }
+    bool isOrdered() const { return m_ordered; }
+
+private:
+    void mergeOrder(const QSet<quint32>& removed, const QSet<quint32>& inserted);
+    bool release(const RosterRecordRef& ref);
+    void dropUnreferenced();
+    
+    QHash<quint32, RosterRecordRef> m_records;
+    QList<RosterBufferPtr> m_buffers;
+    qsizetype m_snapshotBuffers;
+    
+    // Число живых записей в каждом теле дельты
+    QHash<const RosterBuffer*, qsizetype> m_references;
+    QList<quint32> m_order;
+    bool m_ordered;
+};
+
+#endif // ROSTERREPLICA_H
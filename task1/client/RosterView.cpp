@@ -0,0 +1,104 @@
+#include "RosterView.h"
+
+RosterBuffer::RosterBuffer()
+    : m_reader(nullptr, 0, RosterProtocol::SnapshotMessage)
+{
+}
+
+RosterBufferPtr RosterBuffer::fromMessage(zmq::message_t&& message, quint8 envelopeFlags,
+                                          RosterProtocol::MessageType type)
+{
+    std::shared_ptr<RosterBuffer> buffer(new RosterBuffer());
+    buffer->m_message.move(message);
+    
+    if (!buffer->open(buffer->m_message.data<char>(), qsizetype(buffer->m_message.size()), envelopeFlags, type)) {
+        return nullptr;
+    }
+    return buffer;
+}
+
+RosterBufferPtr RosterBuffer::fromBytes(const QByteArray& body, quint8 envelopeFlags, RosterProtocol::MessageType type)
+{
+    std::shared_ptr<RosterBuffer> buffer(new RosterBuffer());
+    buffer->m_bytes = body;
+    
+    if (!buffer->open(buffer->m_bytes.constData(), buffer->m_bytes.size(), envelopeFlags, type)) {
+        return nullptr;
+    }
+    return buffer;
+}
+
+RosterBufferPtr RosterBuffer::fromMapped(const std::shared_ptr<QFile>& file, const char* data, qsizetype size,
+                                         RosterProtocol::MessageType type)
+{
+    // Отображение действует, пока открыт файл; буфер держит ссылку на него
+    std::shared_ptr<RosterBuffer> buffer(new RosterBuffer());
+    buffer->m_file = file;
+    
+    if (!buffer->open(data, size, 0, type)) {
+        return nullptr;
+    }
+    return buffer;
+}
+
+bool RosterBuffer::open(const char* data, qsizetype size, quint8 envelopeFlags, RosterProtocol::MessageType type)
+{
+    if (envelopeFlags & RosterProtocol::CompressedFlag) {
+        // Распакованное тело заменяет сообщение
+        if (!RosterProtocol::decompressBody(QByteArray::fromRawData(data, size), envelopeFlags, m_bytes)) {
+            return false;
+        }
+        m_message.rebuild(size_t(0));
+        data = m_bytes.constData();
+        size = m_bytes.size();
+    }
+    
+    m_body = QByteArrayView(data, size);
+    m_reader = RosterReader(data, size, type);
+    return m_reader.isValid();
+}
+
+QString RosterView::Record::fullName() const
+{
+    QByteArray name;
+    name.reserve(m_record.lastName.size() + m_record.firstName.size() + m_record.middleName.size() + 2);
+    name.append(m_record.lastName).append(' ').append(m_record.firstName);
+    if (!m_record.middleName.isEmpty()) {
+        name.append(' ').append(m_record.middleName);
+    }
+    return QString::fromUtf8(name).simplified();
+}
+
+Student RosterView::Record::toStudent() const
+{
+    return Student(m_record.id, firstName(), middleName(), lastName(), birthDate());
+}
+
+RosterView::RosterView()
+    : d(std::make_shared<const Data>())
+{
+}
+
+RosterView::RosterView(quint64 version, QList<RosterBufferPtr> buffers, QList<RosterRecordRef> records)
+    : d(std::make_shared<const Data>(Data{version, std::move(buffers), std::move(records)}))
+{
+}
+
+QList<Student> RosterView::toStudents() const
+{
+    QList<Student> students;
+    students.reserve(size());
+    for (const Record& record : *this) {
+        students.append(record.toStudent());
+    }
+    return students;
+}
+
+qsizetype RosterView::byteSize() const
+{
+    qsizetype bytes = 0;
+    for (const RosterBufferPtr& buffer : d->buffers) {
+        bytes += buffer->byteSize();
+    }
+    return bytes;
+}
@@ -0,0 +1,145 @@
+#ifndef ROSTERVIEW_H
+#define ROSTERVIEW_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QFile>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <memory>
+#include <zmq.hpp>
+#include "RosterCodec.h"
+#include "Student.h"
+
+class RosterBuffer;
+using RosterBufferPtr = std::shared_ptr<const RosterBuffer>;
+
+// Тело одного принятого сообщения. Сообщение ZeroMQ хранится как есть,
+// копия появляется, только если тело сжато. Тело из кэша на диске
+// читается прямо из отображенного в память файла.
+class RosterBuffer
+{
+public:
+    static RosterBufferPtr fromMessage(zmq::message_t&& message, quint8 envelopeFlags,
+                                       RosterProtocol::MessageType type);
+    static RosterBufferPtr fromBytes(const QByteArray& body, quint8 envelopeFlags,
+                                     RosterProtocol::MessageType type);
+    static RosterBufferPtr fromMapped(const std::shared_ptr<QFile>& file, const char* data, qsizetype size,
+                                      RosterProtocol::MessageType type);
+    
+    const RosterReader& reader() const { return m_reader; }
+    
+    // Несжатое тело
+    QByteArrayView bytes() const { return m_body; }
+    qsizetype byteSize() const { return qsizetype(m_message.size()) + m_bytes.size() + (m_file ? m_body.size() : 0); }
+    
+private:
+    RosterBuffer();
+    bool open(const char* data, qsizetype size, quint8 envelopeFlags, RosterProtocol::MessageType type);
+    
+    zmq::message_t m_message;
+    QByteArray m_bytes;
+    std::shared_ptr<QFile> m_file;
+    QByteArrayView m_body;
+    RosterReader m_reader;
+};
+
+// Запись списка: буфер и смещение записи в нем
+struct RosterRecordRef
+{
+    const RosterBuffer* buffer = nullptr;
+    qsizetype position = 0;
+    
+    RosterRecordView decode() const
+    {
+        RosterRecordView record;
+        buffer->reader().recordAt(position, record);
+        return record;
+    }
+};
+
+// Неизменяемый список студентов поверх принятых сообщений. Поля читаются
+// из буферов при обращении, QString и QDate создаются только по запросу.
+// Копирование дешевое; буферы живут, пока жива хотя бы одна копия.
+class RosterView
+{
+public:
+    class Record
+    {
+    public:
+        qint32 id() const { return m_record.id; }
+        quint32 key() const { return m_record.key; }
+        
+        // UTF-8 в буфере сообщения
+        QByteArrayView firstNameUtf8() const { return m_record.firstName; }
+        QByteArrayView middleNameUtf8() const { return m_record.middleName; }
+        QByteArrayView lastNameUtf8() const { return m_record.lastName; }
+        qint32 julianDay() const { return m_record.julianDay; }
+        
+        QString firstName() const { return QString::fromUtf8(m_record.firstName); }
+        QString middleName() const { return QString::fromUtf8(m_record.middleName); }
+        QString lastName() const { return QString::fromUtf8(m_record.lastName); }
+        QDate birthDate() const { return QDate::fromJulianDay(m_record.julianDay); }
+        
+        // Как Student::fullName, одной строкой из UTF-8 без копии в Student
+        QString fullName() const;
+        
+        Student toStudent() const;
+        
+    private:
+        friend class RosterView;
+        explicit Record(const RosterRecordView& record) : m_record(record) {}
+        
+        RosterRecordView m_record;
+    };
+    
+    class const_iterator
+    {
+    public:
+        Record operator*() const { return m_view->at(m_index); }
+        const_iterator& operator++() { ++m_index; return *this; }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+        
+    private:
+        friend class RosterView;
+        const_iterator(const RosterView* view, qsizetype index) : m_view(view), m_index(index) {}
+        
+        const RosterView* m_view;
+        qsizetype m_index;
+    };
+    
+    RosterView();
+    RosterView(quint64 version, QList<RosterBufferPtr> buffers, QList<RosterRecordRef> records);
+    
+    quint64 version() const { return d->version; }
+    qsizetype size() const { return d->records.size(); }
+    bool isEmpty() const { return d->records.isEmpty(); }
+    
+    Record at(qsizetype index) const { return Record(d->records.at(index).decode()); }
+    Record operator[](qsizetype index) const { return at(index); }
+    
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+    
+    // Полная копия в объекты Student
+    QList<Student> toStudents() const;
+    
+    // Объем буферов сообщений, на которые ссылается список
+    qsizetype byteSize() const;
+    
+private:
+    struct Data
+    {
+        quint64 version = 0;
+        QList<RosterBufferPtr> buffers;
+        QList<RosterRecordRef> records;
+    };
+    
+    std::shared_ptr<const Data> d;
+};
+
+Q_DECLARE_METATYPE(RosterView)
+
+#endif // ROSTERVIEW_H
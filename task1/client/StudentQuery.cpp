@@ -0,0 +1,139 @@
+#include "StudentQuery.h"
+#include "RosterCodec.h"
+#include "RosterLogging.h"
+
+StudentQuery::StudentQuery(const QString& endpoint, zmq::context_t* context)
+    : m_endpoint(endpoint)
+    , m_context(context)
+    , m_ownsContext(context == nullptr)
+    , m_socket(nullptr)
+    , m_timeout(2000)
+    , m_total(0)
+    , m_rosterVersion(0)
+{
+    if (!m_context) {
+        m_context = new zmq::context_t(1);
+    }
+}
+
+StudentQuery::~StudentQuery()
+{
+    resetSocket();
+    
+    if (m_ownsContext) {
+        delete m_context;
+    }
+}
+
+bool StudentQuery::findById(qint32 id, QList<Student>& students)
+{
+    RosterProtocol::Query query;
+    query.type = RosterProtocol::QueryById;
+    query.id = id;
+    return execute(query, students);
+}
+
+bool StudentQuery::findByLastNamePrefix(const QString& prefix, quint32 offset, quint32 limit, QList<Student>& students)
+{
+    RosterProtocol::Query query;
+    query.type = RosterProtocol::QueryByLastNamePrefix;
+    query.lastNamePrefix = prefix.toUtf8();
+    query.offset = offset;
+    query.limit = limit;
+    return execute(query, students);
+}
+
+bool StudentQuery::findByBirthDate(const QDate& from, const QDate& to, quint32 offset, quint32 limit,
+                                   QList<Student>& students)
+{
+    RosterProtocol::Query query;
+    query.type = RosterProtocol::QueryByBirthDateRange;
+    query.fromDay = qint32(from.toJulianDay());
+    query.toDay = qint32(to.toJulianDay());
+    query.offset = offset;
+    query.limit = limit;
+    return execute(query, students);
+}
+
+bool StudentQuery::page(quint32 offset, quint32 limit, QList<Student>& students)
+{
+    RosterProtocol::Query query;
+    query.type = RosterProtocol::QueryPage;
+    query.offset = offset;
+    query.limit = limit;
+    return execute(query, students);
+}
+
+bool StudentQuery::execute(const RosterProtocol::Query& query, QList<Student>& students)
+{
+    students.clear();
+    
+    try {
+        if (!m_socket) {
+            m_socket = new zmq::socket_t(*m_context, ZMQ_REQ);
+            m_socket->set(zmq::sockopt::linger, 0);
+            m_socket->set(zmq::sockopt::rcvtimeo, m_timeout);
+            m_socket->connect(m_endpoint.toStdString());
+        }
+        
+        const QByteArray request = RosterProtocol::encodeQuery(query);
+        m_socket->send(zmq::const_buffer(request.constData(), size_t(request.size())), zmq::send_flags::none);
+        
+        zmq::message_t header;
+        zmq::message_t body;
+        if (!m_socket->recv(header) || !header.more() || !m_socket->recv(body)) {
+            // REQ после пропущенного ответа не примет новый запрос, сокет пересоздается
+            resetSocket();
+            return fail("Query timed out");
+        }
+        
+        RosterProtocol::QueryReply reply;
+        if (!RosterProtocol::decodeQueryReply(header.data<char>(), qsizetype(header.size()), reply)) {
+            return fail("Malformed query reply");
+        }
+        if (reply.status != RosterProtocol::QueryOk) {
+            return fail("Server rejected the query");
+        }
+        
+        RosterReader reader(body.data<char>(), qsizetype(body.size()), RosterProtocol::SnapshotMessage);
+        students.reserve(qsizetype(reader.count()));
+        
+        RosterRecordView record;
+        while (reader.next(record)) {
+            students.append(Student(record.id, QString::fromUtf8(record.firstName),
+                                    QString::fromUtf8(record.middleName), QString::fromUtf8(record.lastName),
+                                    QDate::fromJulianDay(record.julianDay)));
+        }
+        
+        if (!reader.isValid()) {
+            students.clear();
+            return fail("Malformed query reply body");
+        }
+        
+        m_total = reply.total;
+        m_rosterVersion = reply.version;
+        qCDebug(lcTransport) << "Query returned" << students.size() << "of" << m_total
+                 << "students, version" << m_rosterVersion;
+        return true;
+        
+    } catch (const zmq::error_t& e) {
+        resetSocket();
+        return fail(QString("ZMQ error: %1").arg(e.what()));
+    }
+}
+
+bool StudentQuery::fail(const QString& error)
+{
+    m_error = error;
+    qCWarning(lcTransport) << error;
+    return false;
+}
+
+void StudentQuery::resetSocket()
+{
+    if (m_socket) {
+        m_socket->close();
+        delete m_socket;
+        m_socket = nullptr;
+    }
+}
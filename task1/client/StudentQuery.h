@@ -0,0 +1,48 @@
+#ifndef STUDENTQUERY_H
+#define STUDENTQUERY_H
+
+#include <QDate>
+#include <QList>
+#include <QString>
+#include <zmq.hpp>
+#include "RosterProtocol.h"
+#include "Student.h"
+
+// Синхронные запросы к серверу через сокет REQ: один студент или страница
+// списка без подписки на весь список. Студенты возвращаются в порядке ответа сервера.
+class StudentQuery
+{
+public:
+    explicit StudentQuery(const QString& endpoint, zmq::context_t* context = nullptr);
+    ~StudentQuery();
+    
+    void setTimeout(int ms) { m_timeout = qMax(1, ms); }
+    int timeout() const { return m_timeout; }
+    
+    bool findById(qint32 id, QList<Student>& students);
+    bool findByLastNamePrefix(const QString& prefix, quint32 offset, quint32 limit, QList<Student>& students);
+    bool findByBirthDate(const QDate& from, const QDate& to, quint32 offset, quint32 limit, QList<Student>& students);
+    bool page(quint32 offset, quint32 limit, QList<Student>& students);
+    bool execute(const RosterProtocol::Query& query, QList<Student>& students);
+    
+    // Результат последнего успешного запроса
+    quint64 total() const { return m_total; }
+    quint64 rosterVersion() const { return m_rosterVersion; }
+    
+    QString errorString() const { return m_error; }
+    
+private:
+    bool fail(const QString& error);
+    void resetSocket();
+    
+    QString m_endpoint;
+    zmq::context_t* m_context;
+    bool m_ownsContext;
+    zmq::socket_t* m_socket;
+    int m_timeout;
+    quint64 m_total;
+    quint64 m_rosterVersion;
+    QString m_error;
+};
+
+#endif // STUDENTQUERY_H
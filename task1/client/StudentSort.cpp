@@ -0,0 +1,244 @@
+#include "StudentSort.h"
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// Диапазоны меньше этого сортируются сравнениями: счетчики корзин дороже
+const qsizetype kSmallRange = 64;
+
+// Ключи всех студентов подряд, побайтный порядок ключей - порядок кодовых точек.
+// Для Student символ - два байта big-endian, суррогаты сдвинуты выше
+// U+E000..U+FFFF; для записей сообщения - байты UTF-8 как есть.
+// Нулевой символ разделяет поля и меньше любой буквы.
+class SortKeys
+{
+public:
+    explicit SortKeys(const QList<RosterRecordView>& records)
+    {
+        qsizetype length = 0;
+        for (const RosterRecordView& record : records) {
+            length += record.lastName.size() + record.firstName.size() + record.middleName.size() + 2;
+        }
+        
+        m_data.resize(length);
+        m_offsets.reserve(records.size() + 1);
+        m_offsets.append(0);
+        
+        uchar* out = m_data.data();
+        for (const RosterRecordView& record : records) {
+            out = appendBytes(out, record.lastName);
+            *out++ = 0;
+            out = appendBytes(out, record.firstName);
+            *out++ = 0;
+            out = appendBytes(out, record.middleName);
+            m_offsets.append(qsizetype(out - m_data.data()));
+        }
+    }
+    
+    explicit SortKeys(const QList<Student>& students)
+    {
+        qsizetype length = 0;
+        for (const Student& student : students) {
+            length += 2 * (student.lastName().size() + student.firstName().size() + student.middleName().size() + 2);
+        }
+        
+        m_data.resize(length);
+        m_offsets.reserve(students.size() + 1);
+        m_offsets.append(0);
+        
+        uchar* out = m_data.data();
+        for (const Student& student : students) {
+            out = appendField(out, student.lastName());
+            *out++ = 0;
+            *out++ = 0;
+            out = appendField(out, student.firstName());
+            *out++ = 0;
+            *out++ = 0;
+            out = appendField(out, student.middleName());
+            m_offsets.append(qsizetype(out - m_data.data()));
+        }
+    }
+    
+    // 0 - ключ закончился, иначе байт + 1
+    int bucket(qsizetype index, qsizetype depth) const
+    {
+        const qsizetype position = m_offsets[index] + depth;
+        return position < m_offsets[index + 1] ? m_data[position] + 1 : 0;
+    }
+    
+    // Ключи совпадают до depth; при равенстве порядок задает номер
+    bool less(qsizetype left, qsizetype right, qsizetype depth) const
+    {
+        const qsizetype leftLength = m_offsets[left + 1] - m_offsets[left] - depth;
+        const qsizetype rightLength = m_offsets[right + 1] - m_offsets[right] - depth;
+        const qsizetype length = qMin(leftLength, rightLength);
+        
+        const int result = length > 0 ? std::memcmp(m_data.constData() + m_offsets[left] + depth,
+                                                     m_data.constData() + m_offsets[right] + depth, size_t(length))
+                                       : 0;
+        if (result != 0) {
+            return result < 0;
+        }
+        return leftLength != rightLength ? leftLength < rightLength : left < right;
+    }
+    
+private:
+    static uchar* appendBytes(uchar* out, QByteArrayView bytes)
+    {
+        if (!bytes.isEmpty()) {
+            std::memcpy(out, bytes.data(), size_t(bytes.size()));
+        }
+        return out + bytes.size();
+    }
+    
+    static uchar* appendField(uchar* out, const QString& field)
+    {
+        for (QChar c : field) {
+            ushort unit = c.unicode();
+            if (unit >= 0xD800) {
+                unit += unit >= 0xE000 ? -0x800 : 0x2000;
+            }
+            *out++ = uchar(unit >> 8);
+            *out++ = uchar(unit);
+        }
+        return out;
+    }
+    
+    QList<uchar> m_data;
+    QList<qsizetype> m_offsets;
+};
+
+struct Range
+{
+    qsizetype* begin;
+    qsizetype* end;
+    qsizetype depth;
+};
+
+// Один разряд: устойчивое распределение по корзинам через scratch (того же
+// размера, что и диапазон). Корзина 0 - ключи, закончившиеся на этом разряде:
+// они равны и уже идут по возрастанию номеров
+template<typename Visit>
+void distribute(const Range& range, const SortKeys& keys, qsizetype* scratch, Visit visit)
+{
+    qsizetype counts[257] = {};
+    for (const qsizetype* it = range.begin; it != range.end; ++it) {
+        ++counts[keys.bucket(*it, range.depth)];
+    }
+    
+    qsizetype starts[257];
+    qsizetype offset = 0;
+    for (int b = 0; b < 257; ++b) {
+        starts[b] = offset;
+        offset += counts[b];
+    }
+    
+    for (const qsizetype* it = range.begin; it != range.end; ++it) {
+        scratch[starts[keys.bucket(*it, range.depth)]++] = *it;
+    }
+    std::copy(scratch, scratch + (range.end - range.begin), range.begin);
+    
+    offset = counts[0];
+    for (int b = 1; b < 257; ++b) {
+        if (counts[b] > 1) {
+            visit(Range{range.begin + offset, range.begin + offset + counts[b], range.depth + 1},
+                  scratch + offset);
+        }
+        offset += counts[b];
+    }
+}
+
+void msdSort(const Range& range, const SortKeys& keys, qsizetype* scratch)
+{
+    if (range.end - range.begin < kSmallRange) {
+        std::sort(range.begin, range.end, [&keys, &range](qsizetype left, qsizetype right) {
+            return keys.less(left, right, range.depth);
+        });
+        return;
+    }
+    
+    distribute(range, keys, scratch, [&keys](const Range& bucket, qsizetype* bucketScratch) {
+        msdSort(bucket, keys, bucketScratch);
+    });
+}
+
+void parallelMsdSort(const Range& range, const SortKeys& keys, qsizetype* scratch)
+{
+    // Первые разряды делятся последовательно, пока корзины крупнее доли
+    // одного потока: у кириллицы первые байты ключей почти у всех одинаковые
+    const qsizetype grain = qMax(kSmallRange, (range.end - range.begin) / (QThread::idealThreadCount() * 8));
+    
+    QList<Range> tasks;
+    QList<Range> pending{range};
+    while (!pending.isEmpty()) {
+        const Range current = pending.takeLast();
+        if (current.end - current.begin <= grain) {
+            tasks.append(current);
+            continue;
+        }
+        distribute(current, keys, scratch + (current.begin - range.begin),
+                   [&pending](const Range& bucket, qsizetype*) { pending.append(bucket); });
+    }
+    
+    QtConcurrent::blockingMap(tasks, [&](const Range& task) {
+        msdSort(task, keys, scratch + (task.begin - range.begin));
+    });
+}
+
+QList<qsizetype> sortedIndexes(const SortKeys& keys, qsizetype count, StudentSort::Algorithm algorithm)
+{
+    QList<qsizetype> indexes(count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    if (count < 2) {
+        return indexes;
+    }
+    
+    const Range all{indexes.data(), indexes.data() + indexes.size(), 0};
+    
+    if (algorithm == StudentSort::ComparisonSort || count < kSmallRange) {
+        std::sort(all.begin, all.end, [&keys](qsizetype left, qsizetype right) { return keys.less(left, right, 0); });
+        return indexes;
+    }
+    
+    QList<qsizetype> scratch(count);
+    if (algorithm == StudentSort::ParallelRadixSort) {
+        parallelMsdSort(all, keys, scratch.data());
+    } else {
+        msdSort(all, keys, scratch.data());
+    }
+    
+    return indexes;
+}
+
+} // namespace
+
+namespace StudentSort
+{
+
+QList<qsizetype> order(const QList<Student>& students, Algorithm algorithm)
+{
+    return sortedIndexes(SortKeys(students), students.size(), algorithm);
+}
+
+QList<qsizetype> order(const QList<RosterRecordView>& records, Algorithm algorithm)
+{
+    return sortedIndexes(SortKeys(records), records.size(), algorithm);
+}
+
+void sort(QList<Student>& students, Algorithm algorithm)
+{
+    const QList<qsizetype> sorted = order(students, algorithm);
+    
+    QList<Student> result;
+    result.reserve(students.size());
+    for (qsizetype index : sorted) {
+        result.append(std::move(students[index]));
+    }
+    students.swap(result);
+}
+
+} // namespace StudentSort
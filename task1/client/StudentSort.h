@@ -0,0 +1,32 @@
+#ifndef STUDENTSORT_H
+#define STUDENTSORT_H
+
+#include <QList>
+#include "RosterCodec.h"
+#include "Student.h"
+
+// Сортировка по ФИО через ключи сравнения. Ключ строится один раз на
+// студента в общем буфере (фамилия, имя, отчество кодовыми точками с нулевым
+// разделителем), дальше сортируется массив номеров без обращений к QString.
+// Порядок тот же, что у Student::operator<; равные ФИО остаются в исходном порядке.
+namespace StudentSort
+{
+    enum Algorithm
+    {
+        // Сравнения ключей (std::sort); выбирается для маленьких списков
+        ComparisonSort,
+        // Поразрядная сортировка MSD по байтам ключа
+        RadixSort,
+        // MSD: крупные корзины первых разрядов сортируются в пуле потоков
+        ParallelRadixSort
+    };
+    
+    // Номера студентов в порядке ФИО
+    QList<qsizetype> order(const QList<Student>& students, Algorithm algorithm = RadixSort);
+    
+    // То же для записей сообщения: ключом служат сами байты UTF-8, их порядок - порядок кодовых точек
+    QList<qsizetype> order(const QList<RosterRecordView>& records, Algorithm algorithm = RadixSort);
+    void sort(QList<Student>& students, Algorithm algorithm = RadixSort);
+}
+
+#endif // STUDENTSORT_H
@@ -1,17 +1,35 @@
 #include "ZmqClient.h"
+#include "RosterCache.h"
+#include "RosterCodec.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
 #include <QDebug>
-#include <QDataStream>
-#include <QIODevice>
-#include <QTimer>
+#include <QElapsedTimer>
+#include <QMetaMethod>
+#include <algorithm>
+#include <numeric>
 
 ZmqClient::ZmqClient(const QString& endpoint, QObject *parent)
     : QObject(parent)
     , m_endpoint(endpoint)
     , m_context(nullptr)
+    , m_ownsContext(true)
+    , m_sortAlgorithm(StudentSort::RadixSort)
     , m_socket(nullptr)
+    , m_notifier(nullptr)
     , m_running(false)
+    , m_cacheTimer(new QTimer(this))
+    , m_rosterVersion(0)
+    , m_cycleStart(-1)
+    , m_cachePending(false)
 {
     qRegisterMetaType<QList<Student>>("QList<Student>");
+    qRegisterMetaType<RosterView>("RosterView");
+    
+    // Снимки разделов приходят подряд, файл переписывается один раз за пачку
+    m_cacheTimer->setSingleShot(true);
+    m_cacheTimer->setInterval(1000);
+    connect(m_cacheTimer, &QTimer::timeout, this, &ZmqClient::saveCache);
 }
 
 ZmqClient::~ZmqClient()
@@ -21,26 +39,42 @@ ZmqClient::~ZmqClient()
 
 void ZmqClient::start()
 {
+    if (!m_cacheFile.isEmpty()) {
+        loadCache();
+    }
+    
     try {
-        m_context = new zmq::context_t(1);
+        if (!m_context) {
+            m_context = new zmq::context_t(1);
+            m_ownsContext = true;
+        }
         m_socket = new zmq::socket_t(*m_context, ZMQ_SUB);
         
-        m_socket->set(zmq::sockopt::rcvtimeo, 100); 
-        m_socket->set(zmq::sockopt::subscribe, ""); 
+        // Фильтрует сервер: сообщения чужих разделов до клиента не доходят
+        if (m_partitionFilter.isEmpty()) {
+            m_socket->set(zmq::sockopt::subscribe, RosterProtocol::TopicPrefix);
+        } else {
+            for (quint32 partition : std::as_const(m_partitionFilter)) {
+                m_socket->set(zmq::sockopt::subscribe, RosterProtocol::topic(partition).toStdString());
+            }
+            qCInfo(lcTransport) << "Subscribed to partitions" << m_partitionFilter;
+        }
         
-        qDebug() << "Connecting to:" << m_endpoint;
+        qCDebug(lcTransport) << "Connecting to:" << m_endpoint;
         m_socket->connect(m_endpoint.toStdString());
         
         m_running = true;
         
-        QTimer* timer = new QTimer(this);
-        connect(timer, &QTimer::timeout, this, &ZmqClient::receiveStudents);
-        timer->start(100); 
+        m_notifier = new QSocketNotifier(qintptr(m_socket->get(zmq::sockopt::fd)), QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &ZmqClient::receiveStudents);
         
-        qDebug() << "ZMQ Client connected to" << m_endpoint;
+        // Сообщения могли прийти до создания уведомителя, их фронт уже прошел
+        QMetaObject::invokeMethod(this, &ZmqClient::receiveStudents, Qt::QueuedConnection);
         
+        qCInfo(lcTransport) << "ZMQ Client connected to" << m_endpoint;
+    
     } catch (const zmq::error_t& e) {
-        qCritical() << "ZMQ error:" << e.what();
+        qCCritical(lcTransport) << "ZMQ error:" << e.what();
         emit errorOccurred(QString("ZMQ error: %1").arg(e.what()));
     }
 }
@@ -49,118 +83,408 @@ void ZmqClient::stop()
 {
     m_running = false;
     
+    if (m_cacheTimer->isActive()) {
+        m_cacheTimer->stop();
+        saveCache();
+    }
+    
+    delete m_notifier;
+    m_notifier = nullptr;
+    
     if (m_socket) {
         m_socket->close();
         delete m_socket;
         m_socket = nullptr;
     }
     
-    if (m_context) {
+    if (m_context && m_ownsContext) {
         m_context->close();
         delete m_context;
-        m_context = nullptr;
     }
+    m_context = nullptr;
 }
 
 void ZmqClient::receiveStudents()
 {
     if (!m_running || !m_socket) return;
     
+    bool changed = false;
+    
     try {
-        zmq::message_t message;
-        auto result = m_socket->recv(message, zmq::recv_flags::dontwait);
-        
-        if (result.has_value() && result.value() > 0) {
-            QByteArray data(static_cast<char*>(message.data()), message.size());
-            qDebug() << "Received" << data.size() << "bytes";
-            
-            QList<Student> students = deserializeStudents(data);
-            
-            if (!students.isEmpty()) {
-                // Сортируем по фамилии
-                std::sort(students.begin(), students.end());
-                emit studentsReceived(students);
-            } else {
-                qDebug() << "Deserialized empty student list";
-            }
+        // ZMQ_FD сообщает только о смене состояния сокета, а не о каждом
+        // сообщении: очередь вычитывается, пока ZMQ_EVENTS видит входящие
+        while (m_socket->get(zmq::sockopt::events) & ZMQ_POLLIN) {
+            changed = receiveMessage() || changed;
         }
-        
     } catch (const zmq::error_t& e) {
         if (m_running) {
-            qCritical() << "Error receiving message:" << e.what();
+            qCCritical(lcTransport) << "Error receiving message:" << e.what();
             emit errorOccurred(QString("Receive error: %1").arg(e.what()));
         }
     }
+    
+    // Пачка сообщений пересобирает список один раз
+    if (changed) {
+        emitRoster();
+    }
+}
+
+bool ZmqClient::receiveMessage()
+{
+    zmq::message_t topic;
+    auto result = m_socket->recv(topic, zmq::recv_flags::dontwait);
+    
+    if (!result.has_value()) {
+        return false;
+    }
+    
+    // Части составного сообщения доставляются вместе, остальные уже в очереди
+    zmq::message_t header;
+    zmq::message_t message;
+    if (topic.more()) {
+        (void)m_socket->recv(header, zmq::recv_flags::none);
+    }
+    if (header.more()) {
+        (void)m_socket->recv(message, zmq::recv_flags::none);
+    }
+    
+    if (message.more() || header.size() == 0) {
+        qCWarning(lcTransport) << "Unexpected message layout after topic" << QByteArray(static_cast<const char*>(topic.data()), int(topic.size()));
+        while (message.more()) {
+            (void)m_socket->recv(message, zmq::recv_flags::none);
+        }
+        return false;
+    }
+    
+    RosterProtocol::Envelope envelope;
+    if (!RosterProtocol::decodeEnvelope(static_cast<const char*>(header.data()), header.size(), envelope)) {
+        qCWarning(lcTransport) << "Invalid message envelope of" << header.size() << "bytes";
+        return false;
+    }
+    
+    // Раздел создается только для подписки клиента: чужой номер из конверта не заводит запись
+    if (!m_partitionFilter.isEmpty() && !m_partitionFilter.contains(envelope.partition)) {
+        qCWarning(lcTransport) << "Message for unsubscribed partition" << envelope.partition << "dropped";
+        return false;
+    }
+    
+    ++m_stats.messages;
+    m_stats.bytes += header.size() + message.size();
+    RosterMetrics::add(RosterMetrics::ReceivedMessages);
+    RosterMetrics::add(RosterMetrics::ReceivedBytes, quint64(header.size() + message.size()));
+    
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    
+    qCDebug(lcTransport) << "Received" << (envelope.type == RosterProtocol::DeltaMessage ? "delta" : "snapshot")
+             << "partition" << envelope.partition << "#" << envelope.sequence << "version" << envelope.version
+             << "chunk" << envelope.chunkIndex + 1 << "/" << envelope.chunkCount << ","
+             << message.size() << "bytes on the wire";
+    
+    // Тело остается в сообщении ZeroMQ, записи списка ссылаются на него
+    const qsizetype wireSize = qsizetype(message.size());
+    const RosterBufferPtr buffer = RosterBuffer::fromMessage(std::move(message), envelope.flags,
+                                                             RosterProtocol::MessageType(envelope.type));
+    if (!buffer) {
+        qCWarning(lcCodec) << "Malformed or undecompressable message #" << envelope.sequence << "of" << wireSize << "bytes";
+        return false;
+    }
+    
+    bool complete = applyMessage(m_partitions[envelope.partition], envelope, buffer);
+    RosterMetrics::record(RosterMetrics::DecodeTime, decodeTimer.nsecsElapsed());
+    
+    // Разделы удаляются здесь: ссылка на раздел в applyMessage уже не нужна
+    if (envelope.type == RosterProtocol::SnapshotMessage && envelope.chunkIndex + 1 == envelope.chunkCount) {
+        complete = expireCache(envelope.partition) || complete;
+    }
+    return complete;
 }
 
-QList<Student> ZmqClient::deserializeStudents(const QByteArray& data)
+bool ZmqClient::applyMessage(Partition& partition, const RosterProtocol::Envelope& envelope, const RosterBufferPtr& buffer)
 {
-    QList<Student> students;
+    const bool inSequence = envelope.sequence == partition.lastSequence + 1;
+    if (partition.lastSequence != 0 && envelope.sequence > partition.lastSequence + 1) {
+        m_stats.droppedMessages += envelope.sequence - partition.lastSequence - 1;
+    }
+    partition.lastSequence = envelope.sequence;
+    
+    if (envelope.chunkIndex == 0) {
+        if (partition.nextChunk != 0) {
+            qCWarning(lcTransport) << "Partition" << envelope.partition << "message version" << partition.pendingVersion
+                       << "interrupted after chunk" << partition.nextChunk;
+            abortPending(partition);
+        }
+        if (!beginMessage(partition, envelope, inSequence)) {
+            return false;
+        }
+    } else if (!inSequence || envelope.chunkIndex != partition.nextChunk ||
+               envelope.type != partition.pendingType || envelope.version != partition.pendingVersion) {
+        if (partition.nextChunk != 0) {
+            ++m_stats.sequenceGaps;
+            RosterMetrics::add(RosterMetrics::SequenceGaps);
+            qCWarning(lcTransport) << "Sequence gap inside partition" << envelope.partition << "message version"
+                       << partition.pendingVersion << "at chunk" << envelope.chunkIndex << "- resyncing";
+            abortPending(partition);
+        }
+        return false;
+    }
+    
+    ++partition.nextChunk;
+    
+    // Каждая часть декодируется сразу, целиком сообщение в памяти не собирается
+    const RosterProtocol::MessageType type = RosterProtocol::MessageType(envelope.type);
+    RosterReplica& target = type == RosterProtocol::SnapshotMessage ? partition.staging : partition.replica;
+    if (!partition.skipPending && !target.apply(buffer, type)) {
+        abortPending(partition);
+        return false;
+    }
     
-    if (data.isEmpty()) {
-        qDebug() << "Empty data received";
-        return students;
+    if (partition.nextChunk < envelope.chunkCount) {
+        return false;
     }
     
-    qDebug() << "Raw data size:" << data.size() << "bytes";
-    qDebug() << "First 100 bytes hex:" << data.left(100).toHex();
+    partition.nextChunk = 0;
     
-    QDataStream stream(data);
-    stream.setVersion(QDataStream::Qt_5_15);
+    if (partition.skipPending) {
+        // Версия совпала: данные из кэша подтверждены без декодирования
+        partition.skipPending = false;
+        partition.cached = false;
+        return false;
+    }
     
-    // Проверяем статус потока перед чтением
-    if (stream.status() != QDataStream::Ok) {
-        qWarning() << "Stream status error before reading:" << stream.status();
-        return students;
+    if (envelope.type == RosterProtocol::SnapshotMessage) {
+        commitSnapshot(partition, envelope.epoch, envelope.version);
+        if (!m_cacheFile.isEmpty() && !m_cacheTimer->isActive()) {
+            m_cacheTimer->start();
+        }
     }
     
-    int count = 0;
-    stream >> count;
+    partition.version = envelope.version;
+    m_rosterVersion = qMax(m_rosterVersion, envelope.version);
+    return true;
+}
+
+bool ZmqClient::beginMessage(Partition& partition, const RosterProtocol::Envelope& envelope, bool inSequence)
+{
+    partition.pendingType = envelope.type;
+    partition.pendingVersion = envelope.version;
+    partition.skipPending = false;
+    
+    if (envelope.type == RosterProtocol::SnapshotMessage) {
+        // Раздел не изменился, повторно не декодируем. Версия без эпохи ничего
+        // не доказывает: после перезапуска сервер считает версии заново
+        partition.skipPending = partition.synced && envelope.epoch == partition.epoch &&
+                                envelope.version == partition.version;
+        partition.staging.clear();
+        return true;
+    }
     
-    qDebug() << "Trying to read student count, result:" << count;
-    qDebug() << "Stream status after reading count:" << stream.status();
+    if (!partition.synced || partition.cached) {
+        qCDebug(lcTransport) << "Waiting for full snapshot of partition" << envelope.partition
+                 << ", delta #" << envelope.sequence << "skipped";
+        return false;
+    }
     
-    if (stream.status() != QDataStream::Ok) {
-        qWarning() << "Error reading student count from stream, status:" << stream.status();
-        return students;
+    if (!inSequence || envelope.epoch != partition.epoch || envelope.baseVersion != partition.version) {
+        ++m_stats.sequenceGaps;
+        RosterMetrics::add(RosterMetrics::SequenceGaps);
+        qCWarning(lcTransport) << "Sequence gap detected in partition" << envelope.partition << ": expected base version"
+                   << partition.version << "got #" << envelope.sequence << "base version" << envelope.baseVersion
+                   << "- resyncing on next snapshot";
+        partition.synced = false;
+        return false;
     }
     
-    if (count <= 0 || count > 1000) { 
-        qWarning() << "Invalid student count:" << count;
-        return students;
+    return true;
+}
+
+void ZmqClient::abortPending(Partition& partition)
+{
+    // Частично примененная дельта оставляет копию несогласованной
+    if (partition.pendingType == RosterProtocol::DeltaMessage && !partition.skipPending) {
+        partition.synced = false;
     }
     
-    qDebug() << "Deserializing" << count << "students";
+    partition.staging.clear();
+    partition.nextChunk = 0;
+    partition.skipPending = false;
+}
+
+void ZmqClient::commitSnapshot(Partition& partition, quint64 epoch, quint64 version)
+{
+    partition.replica = std::move(partition.staging);
+    partition.staging.clear();
+    partition.synced = true;
+    partition.cached = false;
+    partition.snapshotVersion = version;
+    partition.epoch = epoch;
+}
+
+void ZmqClient::loadCache()
+{
+    QElapsedTimer timer;
+    timer.start();
+    
+    QList<RosterCache::Partition> cached;
+    if (!RosterCache::load(m_cacheFile, cached)) {
+        return;
+    }
     
-    for (int i = 0; i < count; ++i) {
-        if (stream.atEnd()) {
-            qWarning() << "Unexpected end of stream at student" << i;
-            break;
+    for (const RosterCache::Partition& entry : std::as_const(cached)) {
+        if (entry.index >= RosterProtocol::MaxPartitions ||
+            (!m_partitionFilter.isEmpty() && !m_partitionFilter.contains(entry.index))) {
+            continue;
         }
         
-        int id;
-        QString firstName, middleName, lastName;
-        QDate birthDate;
+        Partition& partition = m_partitions[entry.index];
         
-        stream >> id >> firstName >> middleName >> lastName >> birthDate;
+        bool valid = true;
+        for (const RosterBufferPtr& body : entry.bodies) {
+            if (!partition.staging.apply(body, RosterProtocol::SnapshotMessage)) {
+                valid = false;
+                break;
+            }
+        }
         
-        qDebug() << "Read student" << i << ":" << id << firstName << middleName << lastName << birthDate.toString("dd.MM.yyyy");
-        qDebug() << "Stream status:" << stream.status();
+        if (!valid) {
+            qCWarning(lcTransport) << "Cached partition" << entry.index << "ignored";
+            m_partitions.remove(entry.index);
+            continue;
+        }
         
-        if (stream.status() != QDataStream::Ok) {
-            qWarning() << "Error reading student data at index" << i;
-            break;
+        commitSnapshot(partition, entry.epoch, entry.version);
+        partition.version = entry.version;
+        partition.cached = true;
+        m_rosterVersion = qMax(m_rosterVersion, entry.version);
+    }
+    
+    if (m_partitions.isEmpty()) {
+        return;
+    }
+    
+    m_cachePending = true;
+    
+    qCInfo(lcTransport) << "Loaded" << m_partitions.size() << "partitions version" << m_rosterVersion
+            << "from cache" << m_cacheFile << "in" << timer.elapsed() << "ms";
+    emitRoster();
+}
+
+bool ZmqClient::expireCache(quint32 partition)
+{
+    if (!m_cachePending) {
+        return false;
+    }
+    if (m_cycleStart < 0) {
+        m_cycleStart = partition;
+        return false;
+    }
+    if (m_cycleStart != partition) {
+        return false;
+    }
+    
+    // Между двумя снимками одного раздела сервер разослал снимки всех своих
+    // разделов; кэш, который они не подтвердили, сервер больше не публикует
+    m_cachePending = false;
+    bool expired = false;
+    for (auto it = m_partitions.begin(); it != m_partitions.end();) {
+        if (it->cached) {
+            qCInfo(lcTransport) << "Cached partition" << it.key() << "is no longer published, dropped";
+            it = m_partitions.erase(it);
+            expired = true;
+        } else {
+            ++it;
+        }
+    }
+    
+    if (expired && !m_cacheTimer->isActive()) {
+        m_cacheTimer->start();
+    }
+    return expired;
+}
+
+void ZmqClient::saveCache()
+{
+    QList<RosterCache::Partition> partitions;
+    for (auto it = m_partitions.cbegin(); it != m_partitions.cend(); ++it) {
+        if (it->replica.snapshotBuffers() == 0) {
+            continue;
         }
         
-        Student student(id, firstName, middleName, lastName, birthDate);
-        if (student.isValid()) {
-            students.append(student);
-            qDebug() << "  ✓ Added:" << student.fullName();
+        RosterCache::Partition entry;
+        entry.index = it.key();
+        entry.epoch = it->epoch;
+        entry.version = it->snapshotVersion;
+        entry.bodies = it->replica.buffers().mid(0, it->replica.snapshotBuffers());
+        partitions.append(entry);
+    }
+    
+    if (!partitions.isEmpty() && RosterCache::save(m_cacheFile, partitions)) {
+        qCDebug(lcTransport) << "Saved" << partitions.size() << "partitions to cache" << m_cacheFile;
+    }
+}
+
+void ZmqClient::emitRoster()
+{
+    QList<RosterBufferPtr> buffers;
+    QList<RosterRecordRef> refs;
+    bool ordered = true;
+    for (const Partition& partition : std::as_const(m_partitions)) {
+        buffers.append(partition.replica.buffers());
+        ordered = ordered && partition.replica.isOrdered();
+    }
+    
+    // Разделы уже упорядочены сервером: остается слить их, O(n log k) вместо O(n log n)
+    QList<qsizetype> runs;
+    runs.append(0);
+    for (const Partition& partition : std::as_const(m_partitions)) {
+        if (ordered) {
+            for (quint32 key : partition.replica.order()) {
+                refs.append(partition.replica.records().value(key));
+            }
         } else {
-            qWarning() << "  ✗ Invalid student:" << id << firstName << middleName << lastName;
+            for (const RosterRecordRef& ref : partition.replica.records()) {
+                refs.append(ref);
+            }
+        }
+        runs.append(refs.size());
+    }
+    
+    QList<RosterRecordView> records;
+    records.reserve(refs.size());
+    for (const RosterRecordRef& ref : std::as_const(refs)) {
+        records.append(ref.decode());
+    }
+    
+    QList<qsizetype> indexes;
+    if (ordered) {
+        indexes.resize(refs.size());
+        std::iota(indexes.begin(), indexes.end(), 0);
+        
+        const auto less = [&records](qsizetype left, qsizetype right) {
+            return RosterProtocol::compareNames(records[left], records[right]) < 0;
+        };
+        for (qsizetype width = 1; width + 1 < runs.size(); width *= 2) {
+            for (qsizetype i = 0; i + width + 1 < runs.size(); i += 2 * width) {
+                const qsizetype last = qMin(i + 2 * width, runs.size() - 1);
+                std::inplace_merge(indexes.begin() + runs[i], indexes.begin() + runs[i + width],
+                                   indexes.begin() + runs[last], less);
+            }
         }
+    } else {
+        // Ключи сравнения строятся один раз по байтам UTF-8 записей
+        indexes = StudentSort::order(records, m_sortAlgorithm);
     }
     
-    qDebug() << "Successfully deserialized" << students.size() << "students";
-    return students;
+    QList<RosterRecordRef> sorted;
+    sorted.reserve(indexes.size());
+    for (qsizetype index : std::as_const(indexes)) {
+        sorted.append(refs[index]);
+    }
+    
+    const RosterView roster(m_rosterVersion, std::move(buffers), std::move(sorted));
+    emit rosterUpdated(roster);
+    
+    if (isSignalConnected(QMetaMethod::fromSignal(&ZmqClient::studentsReceived))) {
+        emit studentsReceived(roster.toStudents());
+    }
 }
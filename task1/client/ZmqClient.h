@@ -2,9 +2,16 @@
 #define ZMQCLIENT_H
 
 #include <QObject>
+#include <QHash>
 #include <QList>
+#include <QSocketNotifier>
+#include <QTimer>
 #include <zmq.hpp>
+#include "RosterProtocol.h"
+#include "RosterReplica.h"
+#include "RosterView.h"
 #include "Student.h"
+#include "StudentSort.h"
 
 class ZmqClient : public QObject
 {
@@ -17,20 +24,105 @@ public:
     void start();
     void stop();
     
+    quint64 rosterVersion() const { return m_rosterVersion; }
+    
+    struct ReceiveStats
+    {
+        quint64 messages = 0;
+        quint64 bytes = 0;
+        quint64 sequenceGaps = 0;
+        quint64 droppedMessages = 0;
+    };
+    
+    // Читается из потока клиента или после его остановки
+    const ReceiveStats& receiveStats() const { return m_stats; }
+    
+    // Общий контекст нужен для inproc; чужой контекст клиент не закрывает
+    void setContext(zmq::context_t* context) { m_context = context; m_ownsContext = false; }
+    
+    // Сортировка списка, пришедшего без порядка сервера
+    void setSortAlgorithm(StudentSort::Algorithm algorithm) { m_sortAlgorithm = algorithm; }
+    StudentSort::Algorithm sortAlgorithm() const { return m_sortAlgorithm; }
+    
+    // Разделы, на которые подписывается клиент; пустой список - весь список студентов
+    void setPartitions(const QList<quint32>& partitions) { m_partitionFilter = partitions; }
+    QList<quint32> partitions() const { return m_partitionFilter; }
+    
+    // Файл кэша: при старте список сразу берется из него, затем сверяется
+    // со снимками сервера. Пустой путь - без кэша
+    void setCacheFile(const QString& path) { m_cacheFile = path; }
+    QString cacheFile() const { return m_cacheFile; }
+
 signals:
+    // Список поверх принятых сообщений, без копирования записей
+    void rosterUpdated(const RosterView& roster);
+    
+    // Копия списка в Student; собирается, только если к сигналу кто-то подключен
     void studentsReceived(const QList<Student>& students);
     void errorOccurred(const QString& error);
 
 private slots:
     void receiveStudents();
+    void saveCache();
 
 private:
     QString m_endpoint;
     zmq::context_t* m_context;
+    bool m_ownsContext;
+    StudentSort::Algorithm m_sortAlgorithm;
+    ReceiveStats m_stats;
     zmq::socket_t* m_socket;
+    QSocketNotifier* m_notifier;
     bool m_running;
     
-    QList<Student> deserializeStudents(const QByteArray& data);
+    QList<quint32> m_partitionFilter;
+    QString m_cacheFile;
+    QTimer* m_cacheTimer;
+    
+    // Локальная копия раздела, к которой применяются дельты. Записи остаются
+    // в буферах сообщений; буферы дельт копятся до следующего снимка
+    struct Partition
+    {
+        RosterReplica replica;
+        quint64 epoch = 0;
+        quint64 version = 0;
+        quint64 lastSequence = 0;
+        bool synced = false;
+        
+        // Данные из кэша: дельты к ним не применяются, пока снимок сервера
+        // не подтвердит эпоху и версию
+        bool cached = false;
+        
+        // Версия снимка, тела которого лежат в начале буферов копии и пишутся в кэш
+        quint64 snapshotVersion = 0;
+        
+        // Сообщение из нескольких частей, которое принимается сейчас. Части снимка
+        // декодируются по мере прихода, но копятся здесь до последней: до замены
+        // раздел держит и старый, и новый список. Размером части ограничены кадр
+        // и задержка декодирования, а не память
+        RosterReplica staging;
+        quint8 pendingType = RosterProtocol::SnapshotMessage;
+        quint64 pendingVersion = 0;
+        quint32 nextChunk = 0;
+        bool skipPending = false;
+    };
+    
+    QHash<quint32, Partition> m_partitions;
+    quint64 m_rosterVersion;
+    
+    // Раздел, с первого снимка которого отсчитывается полный круг рассылки;
+    // -1 - снимков еще не было. После круга неподтвержденный кэш удаляется
+    qint64 m_cycleStart;
+    bool m_cachePending;
+    
+    bool receiveMessage();
+    bool applyMessage(Partition& partition, const RosterProtocol::Envelope& envelope, const RosterBufferPtr& buffer);
+    bool beginMessage(Partition& partition, const RosterProtocol::Envelope& envelope, bool inSequence);
+    void abortPending(Partition& partition);
+    void commitSnapshot(Partition& partition, quint64 epoch, quint64 version);
+    void loadCache();
+    bool expireCache(quint32 partition);
+    void emitRoster();
 };
 
 #endif // ZMQCLIENT_H
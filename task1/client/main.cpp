@@ -1,7 +1,10 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QLoggingCategory>
 #include <QTimer>
+#include "RosterMetrics.h"
+#include "StudentQuery.h"
 #include "ZmqClient.h"
 
 class StudentDisplay
@@ -22,6 +25,22 @@ public:
         qDebug() << "==============================\n";
     }
     
+    // Поля читаются прямо из принятых сообщений
+    static void displayRoster(const RosterView& roster) {
+        qDebug() << "\n=== Received students list ===";
+        qDebug() << "Total students:" << roster.size() << "version" << roster.version();
+        qDebug() << "==============================";
+        
+        for (const RosterView::Record& student : roster) {
+            qDebug().noquote() 
+                << QString("%1: %2 (%3)")
+                   .arg(student.id())
+                   .arg(student.fullName())
+                   .arg(student.birthDate().toString("dd.MM.yyyy"));
+        }
+        qDebug() << "==============================\n";
+    }
+    
     static void displayError(const QString& error) {
         qCritical() << "Error:" << error;
     }
@@ -47,15 +66,133 @@ int main(int argc, char *argv[])
         "tcp://localhost:5555"
     );
     parser.addOption(endpointOption);
+    
+    QCommandLineOption partitionOption(
+        {"p", "partition"},
+        "Receive only the given roster partition (may be repeated)",
+        "index"
+    );
+    parser.addOption(partitionOption);
+    
+    QCommandLineOption parallelSortOption(
+        "parallel-sort",
+        "Sort unordered rosters on the thread pool"
+    );
+    parser.addOption(parallelSortOption);
+    
+    QCommandLineOption cacheOption(
+        "cache",
+        "Keep the last snapshot in the file and show it right after a restart",
+        "file"
+    );
+    parser.addOption(cacheOption);
+    
+    QCommandLineOption queryOption(
+        {"q", "query"},
+        "Ask the server's query endpoint once instead of subscribing",
+        "endpoint"
+    );
+    parser.addOption(queryOption);
+    
+    QCommandLineOption idOption("id", "Query: student with the given id", "id");
+    parser.addOption(idOption);
+    
+    QCommandLineOption lastNameOption("last-name", "Query: students whose last name starts with the prefix", "prefix");
+    parser.addOption(lastNameOption);
+    
+    QCommandLineOption bornFromOption("born-from", "Query: born on or after the date (dd.MM.yyyy)", "date");
+    parser.addOption(bornFromOption);
+    
+    QCommandLineOption bornToOption("born-to", "Query: born on or before the date (dd.MM.yyyy)", "date");
+    parser.addOption(bornToOption);
+    
+    QCommandLineOption offsetOption("offset", "Query: skip the first N matches", "count", "0");
+    parser.addOption(offsetOption);
+    
+    QCommandLineOption limitOption("limit", "Query: page size (the server caps it at 1000)", "count", "100");
+    parser.addOption(limitOption);
+    
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Logging rules, e.g. \"roster.transport.debug=true;roster.codec.debug=true\"",
+        "rules"
+    );
+    parser.addOption(logRulesOption);
+    
+    QCommandLineOption statsOption(
+        "stats",
+        "Append a JSON line with metrics to the file periodically (\"-\" for stdout)",
+        "file"
+    );
+    parser.addOption(statsOption);
+    
+    QCommandLineOption statsIntervalOption(
+        "stats-interval",
+        "Metrics dump interval in milliseconds",
+        "ms",
+        "10000"
+    );
+    parser.addOption(statsIntervalOption);
     parser.process(app);
     
+    if (parser.isSet(logRulesOption)) {
+        QLoggingCategory::setFilterRules(parser.value(logRulesOption).replace(';', '\n'));
+    }
+    
+    if (parser.isSet(statsOption)) {
+        new MetricsDumper("client", parser.value(statsOption), parser.value(statsIntervalOption).toInt(), &app);
+    }
+    
+    if (parser.isSet(queryOption)) {
+        StudentQuery query(parser.value(queryOption));
+        const quint32 offset = parser.value(offsetOption).toUInt();
+        const quint32 limit = parser.value(limitOption).toUInt();
+        QList<Student> students;
+        bool ok;
+        
+        if (parser.isSet(idOption)) {
+            ok = query.findById(parser.value(idOption).toInt(), students);
+        } else if (parser.isSet(lastNameOption)) {
+            ok = query.findByLastNamePrefix(parser.value(lastNameOption), offset, limit, students);
+        } else if (parser.isSet(bornFromOption) || parser.isSet(bornToOption)) {
+            const QDate from = parser.isSet(bornFromOption)
+                ? QDate::fromString(parser.value(bornFromOption), "dd.MM.yyyy") : QDate(1, 1, 1);
+            const QDate to = parser.isSet(bornToOption)
+                ? QDate::fromString(parser.value(bornToOption), "dd.MM.yyyy") : QDate(9999, 12, 31);
+            ok = query.findByBirthDate(from, to, offset, limit, students);
+        } else {
+            ok = query.page(offset, limit, students);
+        }
+        
+        if (!ok) {
+            StudentDisplay::displayError(query.errorString());
+            return 1;
+        }
+        
+        StudentDisplay::displayStudents(students);
+        qDebug() << "Matched" << query.total() << "students, roster version" << query.rosterVersion();
+        return 0;
+    }
+    
     QString endpoint = parser.value(endpointOption);
     
+    QList<quint32> partitions;
+    for (const QString& value : parser.values(partitionOption)) {
+        partitions.append(value.toUInt());
+    }
+    
     ZmqClient client(endpoint);
+    client.setPartitions(partitions);
+    if (parser.isSet(parallelSortOption)) {
+        client.setSortAlgorithm(StudentSort::ParallelRadixSort);
+    }
+    if (parser.isSet(cacheOption)) {
+        client.setCacheFile(parser.value(cacheOption));
+    }
     
-    QObject::connect(&client, &ZmqClient::studentsReceived, 
-                     [](const QList<Student>& students) {
-                         StudentDisplay::displayStudents(students);
+    QObject::connect(&client, &ZmqClient::rosterUpdated, 
+                     [](const RosterView& roster) {
+                         StudentDisplay::displayRoster(roster);
                      });
     QObject::connect(&client, &ZmqClient::errorOccurred,
                      [](const QString& error) {
@@ -0,0 +1,271 @@
+#include "RosterCodec.h"
+#include <QtEndian>
+
+namespace {
+
+quint64 zigzagEncode(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+qint64 zigzagDecode(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+} // namespace
+
+RosterWriter::RosterWriter(RosterProtocol::MessageType type, bool useStringTable, qsizetype chunkSize)
+    : m_type(type)
+    , m_useStringTable(useStringTable)
+    , m_sorted(false)
+    , m_chunkSize(chunkSize)
+    , m_total(0)
+    , m_count(0)
+{
+}
+
+void RosterWriter::addUpsert(quint32 key, qint32 id, QByteArrayView firstName, QByteArrayView middleName,
+                             QByteArrayView lastName, qint32 julianDay)
+{
+    if (m_type == RosterProtocol::DeltaMessage) {
+        m_records.append(char(RosterProtocol::UpsertChange));
+    }
+    
+    RosterProtocol::appendVarint(m_records, key);
+    RosterProtocol::appendVarint(m_records, zigzagEncode(id));
+    appendName(firstName);
+    appendName(middleName);
+    appendName(lastName);
+    
+    char day[4];
+    qToLittleEndian<qint32>(julianDay, day);
+    m_records.append(day, 4);
+    
+    recordAdded();
+}
+
+void RosterWriter::addRemove(quint32 key)
+{
+    m_records.append(char(RosterProtocol::RemoveChange));
+    RosterProtocol::appendVarint(m_records, key);
+    recordAdded();
+}
+
+void RosterWriter::recordAdded()
+{
+    ++m_count;
+    ++m_total;
+    
+    if (m_chunkSize > 0 && m_records.size() + m_strings.size() >= m_chunkSize) {
+        flushChunk();
+    }
+}
+
+void RosterWriter::appendName(QByteArrayView name)
+{
+    if (!m_useStringTable) {
+        RosterProtocol::appendVarint(m_records, quint64(name.size()));
+        m_records.append(name.data(), name.size());
+        return;
+    }
+    
+    // fromRawData не копирует строку при поиске
+    const QByteArray lookup = QByteArray::fromRawData(name.data(), name.size());
+    auto it = m_stringIds.constFind(lookup);
+    
+    if (it == m_stringIds.constEnd()) {
+        const quint32 index = quint32(m_stringIds.size());
+        it = m_stringIds.insert(QByteArray(name.data(), name.size()), index);
+        RosterProtocol::appendVarint(m_strings, quint64(name.size()));
+        m_strings.append(name.data(), name.size());
+    }
+    
+    RosterProtocol::appendVarint(m_records, it.value());
+}
+
+QList<QByteArray> RosterWriter::finish()
+{
+    if (m_count > 0 || m_chunks.isEmpty()) {
+        flushChunk();
+    }
+    
+    return m_chunks;
+}
+
+void RosterWriter::flushChunk()
+{
+    QByteArray data;
+    data.reserve(m_records.size() + m_strings.size() + 16);
+    
+    quint8 flags = 0;
+    if (m_useStringTable) {
+        flags |= RosterProtocol::StringTableFlag;
+    }
+    if (m_sorted) {
+        flags |= RosterProtocol::SortedFlag;
+    }
+    data.append(char(flags));
+    RosterProtocol::appendVarint(data, m_count);
+    
+    if (m_useStringTable) {
+        RosterProtocol::appendVarint(data, quint64(m_stringIds.size()));
+        data.append(m_strings);
+    }
+    
+    data.append(m_records);
+    m_chunks.append(data);
+    
+    // Каждая часть декодируется сама по себе, в том числе со своей таблицей строк
+    m_count = 0;
+    m_records.clear();
+    m_strings.clear();
+    m_stringIds.clear();
+}
+
+RosterReader::RosterReader(const char* data, qsizetype size, RosterProtocol::MessageType type)
+    : m_begin(reinterpret_cast<const uchar*>(data))
+    , m_cursor(reinterpret_cast<const uchar*>(data))
+    , m_end(reinterpret_cast<const uchar*>(data) + size)
+    , m_type(type)
+    , m_valid(false)
+    , m_useStringTable(false)
+    , m_sorted(false)
+    , m_count(0)
+    , m_read(0)
+{
+    if (m_cursor >= m_end) {
+        return;
+    }
+    
+    const uchar flags = *m_cursor++;
+    m_useStringTable = flags & RosterProtocol::StringTableFlag;
+    m_sorted = flags & RosterProtocol::SortedFlag;
+    
+    // Каждая запись занимает хотя бы байт, так что завышенное число отсекается сразу
+    if (!RosterProtocol::readVarint(m_cursor, m_end, m_count) || m_count > quint64(m_end - m_cursor)) {
+        m_count = 0;
+        return;
+    }
+    
+    if (m_useStringTable) {
+        quint64 stringCount = 0;
+        if (!RosterProtocol::readVarint(m_cursor, m_end, stringCount) || stringCount > quint64(m_end - m_cursor)) {
+            return;
+        }
+        
+        m_strings.reserve(qsizetype(stringCount));
+        for (quint64 i = 0; i < stringCount; ++i) {
+            quint64 length = 0;
+            if (!RosterProtocol::readVarint(m_cursor, m_end, length) || length > quint64(m_end - m_cursor)) {
+                return;
+            }
+            m_strings.append(QByteArrayView(reinterpret_cast<const char*>(m_cursor), qsizetype(length)));
+            m_cursor += length;
+        }
+    }
+    
+    m_valid = true;
+}
+
+bool RosterReader::next(RosterRecordView& record)
+{
+    if (!m_valid || m_read >= m_count) {
+        return false;
+    }
+    
+    if (!decode(m_cursor, record)) {
+        return fail();
+    }
+    
+    ++m_read;
+    return true;
+}
+
+bool RosterReader::recordAt(qsizetype position, RosterRecordView& record) const
+{
+    if (!m_valid || position < 0 || position >= m_end - m_begin) {
+        return false;
+    }
+    
+    const uchar* cursor = m_begin + position;
+    return decode(cursor, record);
+}
+
+bool RosterReader::decode(const uchar*& cursor, RosterRecordView& record) const
+{
+    record.change = RosterProtocol::UpsertChange;
+    if (m_type == RosterProtocol::DeltaMessage) {
+        if (cursor >= m_end) {
+            return false;
+        }
+        record.change = *cursor++;
+    }
+    
+    quint64 key = 0;
+    if (!RosterProtocol::readVarint(cursor, m_end, key) || key > 0xFFFFFFFFu) {
+        return false;
+    }
+    record.key = quint32(key);
+    
+    if (record.change == RosterProtocol::RemoveChange) {
+        record.id = 0;
+        record.firstName = QByteArrayView();
+        record.middleName = QByteArrayView();
+        record.lastName = QByteArrayView();
+        record.julianDay = 0;
+        return true;
+    }
+    
+    if (record.change != RosterProtocol::UpsertChange) {
+        return false;
+    }
+    
+    quint64 id = 0;
+    if (!RosterProtocol::readVarint(cursor, m_end, id)) {
+        return false;
+    }
+    record.id = qint32(zigzagDecode(id));
+    
+    if (!readName(cursor, record.firstName) || !readName(cursor, record.middleName) ||
+        !readName(cursor, record.lastName)) {
+        return false;
+    }
+    
+    if (m_end - cursor < 4) {
+        return false;
+    }
+    record.julianDay = qFromLittleEndian<qint32>(cursor);
+    cursor += 4;
+    return true;
+}
+
+bool RosterReader::readName(const uchar*& cursor, QByteArrayView& name) const
+{
+    quint64 value = 0;
+    if (!RosterProtocol::readVarint(cursor, m_end, value)) {
+        return false;
+    }
+    
+    if (m_useStringTable) {
+        if (value >= quint64(m_strings.size())) {
+            return false;
+        }
+        name = m_strings.at(qsizetype(value));
+        return true;
+    }
+    
+    if (value > quint64(m_end - cursor)) {
+        return false;
+    }
+    
+    name = QByteArrayView(reinterpret_cast<const char*>(cursor), qsizetype(value));
+    cursor += value;
+    return true;
+}
+
+bool RosterReader::fail()
+{
+    m_valid = false;
+    return false;
+}
@@ -0,0 +1,98 @@
+#ifndef ROSTERCODEC_H
+#define ROSTERCODEC_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+#include "RosterProtocol.h"
+
+// Запись тела сообщения. Имена - UTF-8 представления прямо в буфере сообщения.
+struct RosterRecordView
+{
+    quint8 change = RosterProtocol::UpsertChange;
+    quint32 key = 0;
+    qint32 id = 0;
+    QByteArrayView firstName;
+    QByteArrayView middleName;
+    QByteArrayView lastName;
+    qint32 julianDay = 0;
+};
+
+// Тело: флаги, число записей (varint), необязательная таблица строк, записи.
+// При заданном размере части записи делятся на независимые тела такого формата.
+// Запись: [тип изменения для дельты] ключ (varint), id (zigzag varint),
+// три имени (длина + UTF-8 или номер в таблице строк), юлианский день (int32 LE).
+class RosterWriter
+{
+public:
+    explicit RosterWriter(RosterProtocol::MessageType type, bool useStringTable = false,
+                          qsizetype chunkSize = 0);
+    
+    void addUpsert(quint32 key, qint32 id, QByteArrayView firstName, QByteArrayView middleName,
+                   QByteArrayView lastName, qint32 julianDay);
+    void addRemove(quint32 key);
+    
+    RosterProtocol::MessageType type() const { return m_type; }
+    
+    // Записи добавляются в порядке ФИО; тела получают SortedFlag
+    void setSorted(bool sorted) { m_sorted = sorted; }
+    bool isSorted() const { return m_sorted; }
+    
+    quint64 count() const { return m_total; }
+    QList<QByteArray> finish();
+    
+private:
+    void appendName(QByteArrayView name);
+    void recordAdded();
+    void flushChunk();
+    
+    RosterProtocol::MessageType m_type;
+    bool m_useStringTable;
+    bool m_sorted;
+    qsizetype m_chunkSize;
+    quint64 m_total;
+    quint64 m_count;
+    QList<QByteArray> m_chunks;
+    QByteArray m_records;
+    QByteArray m_strings;
+    QHash<QByteArray, quint32> m_stringIds;
+};
+
+class RosterReader
+{
+public:
+    RosterReader(const char* data, qsizetype size, RosterProtocol::MessageType type);
+    
+    // Флаги тела без разбора таблицы строк
+    static quint8 bodyFlags(const char* data, qsizetype size) { return size > 0 ? quint8(data[0]) : 0; }
+    
+    bool isValid() const { return m_valid; }
+    bool isSorted() const { return m_sorted; }
+    quint64 count() const { return m_count; }
+    bool atEnd() const { return m_read >= m_count; }
+    
+    bool next(RosterRecordView& record);
+    
+    // Смещение следующей записи от начала тела; по нему запись читается повторно
+    qsizetype position() const { return m_cursor - m_begin; }
+    bool recordAt(qsizetype position, RosterRecordView& record) const;
+    
+private:
+    bool decode(const uchar*& cursor, RosterRecordView& record) const;
+    bool readName(const uchar*& cursor, QByteArrayView& name) const;
+    bool fail();
+    
+    const uchar* m_begin;
+    const uchar* m_cursor;
+    const uchar* m_end;
+    RosterProtocol::MessageType m_type;
+    bool m_valid;
+    bool m_useStringTable;
+    bool m_sorted;
+    quint64 m_count;
+    quint64 m_read;
+    QList<QByteArrayView> m_strings;
+};
+
+#endif // ROSTERCODEC_H
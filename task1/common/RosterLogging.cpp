@@ -0,0 +1,6 @@
+#include "RosterLogging.h"
+
+Q_LOGGING_CATEGORY(lcParser, "roster.parser", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcDedup, "roster.dedup", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcCodec, "roster.codec", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcTransport, "roster.transport", QtInfoMsg)
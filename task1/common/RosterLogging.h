@@ -0,0 +1,23 @@
+#ifndef ROSTERLOGGING_H
+#define ROSTERLOGGING_H
+
+#include <QLoggingCategory>
+
+// Категории журнала. Уровни меняются во время работы правилами
+// QT_LOGGING_RULES или --log-rules, например "roster.transport.debug=true".
+// По умолчанию выводятся info и выше; отключенная категория проверяется
+// до форматирования, поэтому аргументы qCDebug не вычисляются.
+Q_DECLARE_LOGGING_CATEGORY(lcParser)
+Q_DECLARE_LOGGING_CATEGORY(lcDedup)
+Q_DECLARE_LOGGING_CATEGORY(lcCodec)
+Q_DECLARE_LOGGING_CATEGORY(lcTransport)
+
+// Трассировка отдельных записей. Без TASK1_TRACE_RECORDS в сборке
+// вызов вместе с аргументами удаляется компилятором.
+#ifdef TASK1_TRACE_RECORDS
+#  define ROSTER_TRACE(category) qCDebug(category)
+#else
+#  define ROSTER_TRACE(category) while (false) QMessageLogger().noDebug()
+#endif
+
+#endif // ROSTERLOGGING_H
@@ -0,0 +1,208 @@
+#include "RosterMetrics.h"
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutex>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace RosterMetrics
+{
+
+namespace {
+
+// Корзина i содержит значения из [2^(i-1), 2^i) нс
+const int kBucketCount = 64;
+
+const char* const kCounterNames[CounterCount] = {
+    "parsed_bytes",
+    "parsed_records",
+    "parse_errors",
+    "dedup_lookups",
+    "dedup_hits",
+    "serialized_records",
+    "serialized_bytes",
+    "published_messages",
+    "published_bytes",
+    "received_messages",
+    "received_bytes",
+    "decoded_records",
+    "sequence_gaps",
+    "queries_served",
+    "query_errors"
+};
+
+const char* const kHistogramNames[HistogramCount] = {
+    "parse_ns",
+    "dedup_ns",
+    "serialize_ns",
+    "publish_ns",
+    "decode_ns",
+    "query_ns",
+    "near_dedup_ns"
+};
+
+// Значения одного потока. Пишет только владелец (load + store без lock-префикса),
+// читатель видит согласованные по отдельности, но не между собой значения.
+struct Shard
+{
+    std::atomic<quint64> counters[CounterCount] = {};
+    std::atomic<quint64> buckets[HistogramCount][kBucketCount] = {};
+    std::atomic<quint64> sums[HistogramCount] = {};
+    std::atomic<quint64> maxima[HistogramCount] = {};
+};
+
+void bump(std::atomic<quint64>& value, quint64 delta)
+{
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// Наборы не удаляются при завершении потока: их значения остаются в сумме
+QMutex registryMutex;
+std::vector<std::unique_ptr<Shard>> registry;
+
+Shard& localShard()
+{
+    thread_local Shard* shard = nullptr;
+    if (!shard) {
+        QMutexLocker locker(&registryMutex);
+        registry.push_back(std::make_unique<Shard>());
+        shard = registry.back().get();
+    }
+    return *shard;
+}
+
+int bucketOf(quint64 value)
+{
+    int bucket = 0;
+    while (value && bucket < kBucketCount - 1) {
+        value >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+quint64 percentile(const quint64* buckets, quint64 count, double fraction)
+{
+    const quint64 rank = quint64(double(count) * fraction);
+    quint64 seen = 0;
+    for (int i = 0; i < kBucketCount; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            // Верхняя граница корзины
+            return i == 0 ? 0 : (quint64(1) << i) - 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+void add(Counter counter, quint64 value)
+{
+    bump(localShard().counters[counter], value);
+}
+
+void record(Histogram histogram, qint64 nanoseconds)
+{
+    const quint64 value = quint64(qMax<qint64>(0, nanoseconds));
+    Shard& shard = localShard();
+    
+    bump(shard.buckets[histogram][bucketOf(value)], 1);
+    bump(shard.sums[histogram], value);
+    if (value > shard.maxima[histogram].load(std::memory_order_relaxed)) {
+        shard.maxima[histogram].store(value, std::memory_order_relaxed);
+    }
+}
+
+QJsonObject snapshot()
+{
+    quint64 counters[CounterCount] = {};
+    quint64 buckets[HistogramCount][kBucketCount] = {};
+    quint64 sums[HistogramCount] = {};
+    quint64 maxima[HistogramCount] = {};
+    
+    {
+        QMutexLocker locker(&registryMutex);
+        for (const std::unique_ptr<Shard>& shard : registry) {
+            for (int i = 0; i < CounterCount; ++i) {
+                counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+            }
+            for (int h = 0; h < HistogramCount; ++h) {
+                for (int b = 0; b < kBucketCount; ++b) {
+                    buckets[h][b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+                }
+                sums[h] += shard->sums[h].load(std::memory_order_relaxed);
+                maxima[h] = qMax(maxima[h], shard->maxima[h].load(std::memory_order_relaxed));
+            }
+        }
+    }
+    
+    QJsonObject counterValues;
+    for (int i = 0; i < CounterCount; ++i) {
+        counterValues.insert(kCounterNames[i], qint64(counters[i]));
+    }
+    
+    QJsonObject histogramValues;
+    for (int h = 0; h < HistogramCount; ++h) {
+        quint64 count = 0;
+        for (int b = 0; b < kBucketCount; ++b) {
+            count += buckets[h][b];
+        }
+        if (count == 0) {
+            continue;
+        }
+        
+        QJsonObject histogram;
+        histogram.insert("count", qint64(count));
+        histogram.insert("sum", qint64(sums[h]));
+        histogram.insert("p50", qint64(percentile(buckets[h], count, 0.50)));
+        histogram.insert("p90", qint64(percentile(buckets[h], count, 0.90)));
+        histogram.insert("p99", qint64(percentile(buckets[h], count, 0.99)));
+        histogram.insert("max", qint64(maxima[h]));
+        histogramValues.insert(kHistogramNames[h], histogram);
+    }
+    
+    QJsonObject result;
+    result.insert("counters", counterValues);
+    result.insert("histograms", histogramValues);
+    return result;
+}
+
+} // namespace RosterMetrics
+
+MetricsDumper::MetricsDumper(const QString& component, const QString& path, int intervalMs, QObject *parent)
+    : QObject(parent)
+    , m_component(component)
+    , m_file(new QFile(this))
+    , m_timer(new QTimer(this))
+{
+    if (path == "-") {
+        m_file->open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    } else {
+        m_file->setFileName(path);
+        m_file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
+    }
+    
+    m_timer->setInterval(qMax(100, intervalMs));
+    connect(m_timer, &QTimer::timeout, this, &MetricsDumper::dump);
+    m_timer->start();
+}
+
+void MetricsDumper::dump()
+{
+    if (!m_file->isOpen()) {
+        return;
+    }
+    
+    QJsonObject stats = RosterMetrics::snapshot();
+    stats.insert("component", m_component);
+    stats.insert("timestamp", QDateTime::currentDateTimeUtc().toString(Qt::ISODateWithMs));
+    
+    m_file->write(QJsonDocument(stats).toJson(QJsonDocument::Compact));
+    m_file->write("\n");
+    m_file->flush();
+}
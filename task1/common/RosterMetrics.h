@@ -0,0 +1,88 @@
+#ifndef ROSTERMETRICS_H
+#define ROSTERMETRICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QObject>
+
+class QFile;
+class QTimer;
+
+// Счетчики и гистограммы задержек этапов обработки списка.
+// Каждый поток пишет в свой набор без блокировок и атомарных RMW-операций;
+// при чтении наборы всех потоков суммируются.
+namespace RosterMetrics
+{
+    enum Counter : int
+    {
+        ParsedBytes,
+        ParsedRecords,
+        ParseErrors,
+        DedupLookups,
+        DedupHits,
+        SerializedRecords,
+        SerializedBytes,
+        PublishedMessages,
+        PublishedBytes,
+        ReceivedMessages,
+        ReceivedBytes,
+        DecodedRecords,
+        SequenceGaps,
+        QueriesServed,
+        QueryErrors,
+        CounterCount
+    };
+    
+    enum Histogram : int
+    {
+        ParseTime,
+        DedupTime,
+        SerializeTime,
+        PublishTime,
+        DecodeTime,
+        QueryTime,
+        NearDuplicateTime,
+        HistogramCount
+    };
+    
+    void add(Counter counter, quint64 value = 1);
+    void record(Histogram histogram, qint64 nanoseconds);
+    
+    // Сумма по всем потокам: счетчики и для гистограмм count, sum, p50, p90, p99, max (нс)
+    QJsonObject snapshot();
+    
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(Histogram histogram)
+            : m_histogram(histogram)
+        {
+            m_timer.start();
+        }
+        
+        ~ScopedTimer() { record(m_histogram, m_timer.nsecsElapsed()); }
+        
+    private:
+        Histogram m_histogram;
+        QElapsedTimer m_timer;
+    };
+}
+
+// Периодически дописывает снимок метрик одной строкой JSON в файл ("-" - stdout)
+class MetricsDumper : public QObject
+{
+    Q_OBJECT
+
+public:
+    MetricsDumper(const QString& component, const QString& path, int intervalMs, QObject *parent = nullptr);
+    
+public slots:
+    void dump();
+    
+private:
+    QString m_component;
+    QFile* m_file;
+    QTimer* m_timer;
+};
+
+#endif // ROSTERMETRICS_H
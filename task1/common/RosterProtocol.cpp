@@ -0,0 +1,215 @@
+#include "RosterProtocol.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace RosterProtocol
+{
+
+QByteArray topic(quint32 partition)
+{
+    return QByteArray(TopicPrefix) + QByteArray::number(partition) + '/';
+}
+
+quint32 partitionOf(QByteArrayView lastName, quint32 partitionCount)
+{
+    if (partitionCount <= 1) {
+        return 0;
+    }
+    
+    // FNV-1a по UTF-8: не зависит от случайного зерна qHash, поэтому
+    // подписчик может сам вычислить раздел нужной фамилии
+    quint32 hash = 2166136261u;
+    for (char c : lastName) {
+        hash = (hash ^ uchar(c)) * 16777619u;
+    }
+    
+    return hash % partitionCount;
+}
+
+int compareBytes(QByteArrayView left, QByteArrayView right)
+{
+    const qsizetype length = qMin(left.size(), right.size());
+    const int result = length > 0 ? std::memcmp(left.data(), right.data(), size_t(length)) : 0;
+    if (result != 0) {
+        return result;
+    }
+    return left.size() < right.size() ? -1 : (left.size() > right.size() ? 1 : 0);
+}
+
+QByteArray encodeEnvelope(const Envelope& envelope)
+{
+    QByteArray data(EnvelopeSize, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    
+    qToLittleEndian<quint32>(Magic, out);
+    out[4] = ProtocolVersion;
+    out[5] = envelope.type;
+    out[6] = envelope.flags;
+    qToLittleEndian<quint64>(envelope.sequence, out + 7);
+    qToLittleEndian<quint64>(envelope.baseVersion, out + 15);
+    qToLittleEndian<quint64>(envelope.version, out + 23);
+    qToLittleEndian<quint32>(envelope.chunkIndex, out + 31);
+    qToLittleEndian<quint32>(envelope.chunkCount, out + 35);
+    qToLittleEndian<quint32>(envelope.partition, out + 39);
+    qToLittleEndian<quint64>(envelope.epoch, out + 43);
+    
+    return data;
+}
+
+bool decodeEnvelope(const char* data, qsizetype size, Envelope& envelope)
+{
+    if (size < EnvelopeSize) {
+        return false;
+    }
+    
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    if (qFromLittleEndian<quint32>(in) != Magic || in[4] != ProtocolVersion) {
+        return false;
+    }
+    
+    envelope.type = in[5];
+    envelope.flags = in[6];
+    envelope.sequence = qFromLittleEndian<quint64>(in + 7);
+    envelope.baseVersion = qFromLittleEndian<quint64>(in + 15);
+    envelope.version = qFromLittleEndian<quint64>(in + 23);
+    envelope.chunkIndex = qFromLittleEndian<quint32>(in + 31);
+    envelope.chunkCount = qFromLittleEndian<quint32>(in + 35);
+    envelope.partition = qFromLittleEndian<quint32>(in + 39);
+    envelope.epoch = qFromLittleEndian<quint64>(in + 43);
+    
+    if (envelope.chunkCount == 0 || envelope.chunkIndex >= envelope.chunkCount ||
+        envelope.partition >= MaxPartitions) {
+        return false;
+    }
+    
+    return envelope.type == SnapshotMessage || envelope.type == DeltaMessage;
+}
+
+QByteArray encodeQuery(const Query& query)
+{
+    QByteArray data(QueryHeaderSize, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    
+    qToLittleEndian<quint32>(Magic, out);
+    out[4] = ProtocolVersion;
+    out[5] = query.type;
+    qToLittleEndian<qint32>(query.id, out + 6);
+    qToLittleEndian<qint32>(query.fromDay, out + 10);
+    qToLittleEndian<qint32>(query.toDay, out + 14);
+    qToLittleEndian<quint32>(query.offset, out + 18);
+    qToLittleEndian<quint32>(query.limit, out + 22);
+    
+    data.append(query.lastNamePrefix);
+    return data;
+}
+
+bool decodeQuery(const char* data, qsizetype size, Query& query)
+{
+    if (size < QueryHeaderSize) {
+        return false;
+    }
+    
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    if (qFromLittleEndian<quint32>(in) != Magic || in[4] != ProtocolVersion) {
+        return false;
+    }
+    
+    query.type = in[5];
+    query.id = qFromLittleEndian<qint32>(in + 6);
+    query.fromDay = qFromLittleEndian<qint32>(in + 10);
+    query.toDay = qFromLittleEndian<qint32>(in + 14);
+    query.offset = qFromLittleEndian<quint32>(in + 18);
+    query.limit = qFromLittleEndian<quint32>(in + 22);
+    query.lastNamePrefix = QByteArray(data + QueryHeaderSize, size - QueryHeaderSize);
+    
+    return query.type >= QueryById && query.type <= QueryPage;
+}
+
+QByteArray encodeQueryReply(const QueryReply& reply)
+{
+    QByteArray data(QueryReplySize, Qt::Uninitialized);
+    uchar* out = reinterpret_cast<uchar*>(data.data());
+    
+    qToLittleEndian<quint32>(Magic, out);
+    out[4] = ProtocolVersion;
+    out[5] = reply.status;
+    qToLittleEndian<quint64>(reply.version, out + 6);
+    qToLittleEndian<quint64>(reply.total, out + 14);
+    
+    return data;
+}
+
+bool decodeQueryReply(const char* data, qsizetype size, QueryReply& reply)
+{
+    if (size < QueryReplySize) {
+        return false;
+    }
+    
+    const uchar* in = reinterpret_cast<const uchar*>(data);
+    if (qFromLittleEndian<quint32>(in) != Magic || in[4] != ProtocolVersion) {
+        return false;
+    }
+    
+    reply.status = in[5];
+    reply.version = qFromLittleEndian<quint64>(in + 6);
+    reply.total = qFromLittleEndian<quint64>(in + 14);
+    return true;
+}
+
+QByteArray compressBody(const QByteArray& body, quint8& flags)
+{
+    // Мелкие тела (дельты) не окупают заголовок zlib
+    if (body.size() < 256) {
+        return body;
+    }
+    
+    QByteArray compressed = qCompress(body);
+    if (compressed.size() >= body.size()) {
+        return body;
+    }
+    
+    flags |= CompressedFlag;
+    return compressed;
+}
+
+bool decompressBody(const QByteArray& body, quint8 flags, QByteArray& out)
+{
+    if (!(flags & CompressedFlag)) {
+        out = body;
+        return true;
+    }
+    
+    out = qUncompress(body);
+    return !out.isEmpty();
+}
+
+void appendVarint(QByteArray& out, quint64 value)
+{
+    char buffer[10];
+    int length = 0;
+    
+    while (value >= 0x80) {
+        buffer[length++] = char((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = char(value);
+    
+    out.append(buffer, length);
+}
+
+bool readVarint(const uchar*& cursor, const uchar* end, quint64& value)
+{
+    value = 0;
+    
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        const uchar byte = *cursor++;
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+} // namespace RosterProtocol
@@ -0,0 +1,149 @@
+#ifndef ROSTERPROTOCOL_H
+#define ROSTERPROTOCOL_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+
+// Общий для сервера и клиента формат сообщений со списком студентов.
+// Сообщение состоит из трех кадров ZeroMQ: темы раздела, конверта (тип,
+// номер, версии) и тела с записями. Тело кодируется один раз на версию и переиспользуется.
+// Большой снимок или дельта делится на части ограниченного размера; каждая
+// часть - отдельное сообщение со своим номером и декодируется независимо.
+// Список делится на разделы по фамилии; у каждого раздела своя тема, свои
+// номера сообщений и версии, поэтому подписчик может получать только часть.
+namespace RosterProtocol
+{
+    const quint32 Magic = 0x52535452;
+    // 5: раздел считается по байтам UTF-8 фамилии; клиент версии 4 вычислил бы
+    // другие разделы и подписался бы не на те темы.
+    // 6: конверт несет эпоху сервера
+    const quint8 ProtocolVersion = 6;
+    
+    // magic, версия протокола, тип, флаги, номер, базовая версия, версия,
+    // номер и число частей, номер раздела, эпоха
+    const qsizetype EnvelopeSize = 4 + 1 + 1 + 1 + 8 + 8 + 8 + 4 + 4 + 4 + 8;
+    
+    // Тема раздела: "roster/<номер>/"; завершающий '/' не дает теме
+    // "roster/1/" совпасть по префиксу с "roster/10/"
+    const char TopicPrefix[] = "roster/";
+    
+    // Конверт с номером раздела не меньше этого отбрасывается
+    const quint32 MaxPartitions = 1024;
+    
+    enum MessageType : quint8
+    {
+        SnapshotMessage = 1,
+        DeltaMessage = 2
+    };
+    
+    enum ChangeType : quint8
+    {
+        UpsertChange = 1,
+        RemoveChange = 2
+    };
+    
+    // SortedFlag: записи снимка идут в порядке ФИО сервера, части раздела продолжают
+    // друг друга, и клиенту не нужно сортировать раздел заново
+    enum BodyFlag : quint8
+    {
+        StringTableFlag = 0x01,
+        SortedFlag = 0x02
+    };
+    
+    enum EnvelopeFlag : quint8
+    {
+        CompressedFlag = 0x01
+    };
+    
+    struct Envelope
+    {
+        quint8 type = SnapshotMessage;
+        quint8 flags = 0;
+        quint64 sequence = 0;
+        quint64 baseVersion = 0;
+        quint64 version = 0;
+        quint32 chunkIndex = 0;
+        quint32 chunkCount = 1;
+        quint32 partition = 0;
+        // Случайное число, выбранное сервером при запуске. Версии после
+        // перезапуска начинаются заново, одна версия разных эпох - разные списки
+        quint64 epoch = 0;
+    };
+    
+    // Запрос к серверу (REQ/ROUTER): magic, версия протокола, тип запроса,
+    // id, диапазон юлианских дней, смещение и размер страницы, префикс фамилии до конца кадра
+    const qsizetype QueryHeaderSize = 4 + 1 + 1 + 4 + 4 + 4 + 4 + 4;
+    
+    // Ответ: кадр заголовка (magic, версия протокола, статус, версия списка,
+    // число подходящих студентов) и тело снимка с найденной страницей в порядке индекса
+    const qsizetype QueryReplySize = 4 + 1 + 1 + 8 + 8;
+    
+    enum QueryType : quint8
+    {
+        QueryById = 1,
+        QueryByLastNamePrefix = 2,
+        QueryByBirthDateRange = 3,
+        QueryPage = 4
+    };
+    
+    enum QueryStatus : quint8
+    {
+        QueryOk = 0,
+        QueryMalformed = 1
+    };
+    
+    struct Query
+    {
+        quint8 type = QueryPage;
+        qint32 id = 0;
+        qint32 fromDay = 0;
+        qint32 toDay = 0;
+        quint32 offset = 0;
+        quint32 limit = 0;
+        QByteArray lastNamePrefix;
+    };
+    
+    struct QueryReply
+    {
+        quint8 status = QueryOk;
+        quint64 version = 0;
+        quint64 total = 0;
+    };
+    
+    QByteArray topic(quint32 partition);
+    quint32 partitionOf(QByteArrayView lastName, quint32 partitionCount);
+    
+    // Порядок снимка: байты UTF-8 фамилии, имени и отчества. Им сортирует
+    // сервер и сливает разделы клиент, поэтому сравнение у них одно
+    int compareBytes(QByteArrayView left, QByteArrayView right);
+    
+    template<typename Row>
+    int compareNames(const Row& left, const Row& right)
+    {
+        int result = compareBytes(left.lastName, right.lastName);
+        if (result == 0) {
+            result = compareBytes(left.firstName, right.firstName);
+        }
+        if (result == 0) {
+            result = compareBytes(left.middleName, right.middleName);
+        }
+        return result;
+    }
+    
+    QByteArray encodeEnvelope(const Envelope& envelope);
+    bool decodeEnvelope(const char* data, qsizetype size, Envelope& envelope);
+    
+    QByteArray encodeQuery(const Query& query);
+    bool decodeQuery(const char* data, qsizetype size, Query& query);
+    QByteArray encodeQueryReply(const QueryReply& reply);
+    bool decodeQueryReply(const char* data, qsizetype size, QueryReply& reply);
+    
+    // Сжатие тела (zlib через qCompress); флаг выставляется, только если тело стало меньше
+    QByteArray compressBody(const QByteArray& body, quint8& flags);
+    bool decompressBody(const QByteArray& body, quint8 flags, QByteArray& out);
+    
+    void appendVarint(QByteArray& out, quint64 value);
+    bool readVarint(const uchar*& cursor, const uchar* end, quint64& value);
+}
+
+#endif // ROSTERPROTOCOL_H
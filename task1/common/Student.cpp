@@ -0,0 +1,77 @@
+#include "Student.h"
+#include <QDebug>
+
+namespace {
+
+// Суррогаты UTF-16 поднимаются выше U+E000..U+FFFF, чтобы порядок совпал с порядком кодовых точек
+int compareCodePoints(const QString& left, const QString& right)
+{
+    const qsizetype length = qMin(left.size(), right.size());
+    for (qsizetype i = 0; i < length; ++i) {
+        ushort a = left.at(i).unicode();
+        ushort b = right.at(i).unicode();
+        if (a == b) {
+            continue;
+        }
+        if (a >= 0xD800 && b >= 0xD800) {
+            a += a >= 0xE000 ? -0x800 : 0x2000;
+            b += b >= 0xE000 ? -0x800 : 0x2000;
+        }
+        return a < b ? -1 : 1;
+    }
+    return left.size() < right.size() ? -1 : (left.size() > right.size() ? 1 : 0);
+}
+
+} // namespace
+
+Student::Student() 
+    : m_id(-1)
+{
+}
+
+Student::Student(int id, const QString& firstName, const QString& middleName,
+                 const QString& lastName, const QDate& birthDate)
+    : m_id(id)
+    , m_firstName(firstName)
+    , m_middleName(middleName)
+    , m_lastName(lastName)
+    , m_birthDate(birthDate)
+{
+}
+
+bool Student::isValid() const
+{
+    return m_id > 0 && 
+           !m_firstName.isEmpty() && 
+           !m_lastName.isEmpty() && 
+           m_birthDate.isValid();
+}
+
+QString Student::fullName() const
+{
+    if (m_middleName.isEmpty()) {
+        return QString("%1 %2").arg(m_lastName, m_firstName).simplified();
+    } else {
+        return QString("%1 %2 %3").arg(m_lastName, m_firstName, m_middleName).simplified();
+    }
+}
+
+bool Student::operator==(const Student& other) const
+{
+    return m_firstName == other.m_firstName &&
+           m_middleName == other.m_middleName &&
+           m_lastName == other.m_lastName &&
+           m_birthDate == other.m_birthDate;
+}
+
+int Student::compareNames(const Student& left, const Student& right)
+{
+    int result = compareCodePoints(left.m_lastName, right.m_lastName);
+    if (result == 0) {
+        result = compareCodePoints(left.m_firstName, right.m_firstName);
+    }
+    if (result == 0) {
+        result = compareCodePoints(left.m_middleName, right.m_middleName);
+    }
+    return result;
+}
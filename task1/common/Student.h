@@ -27,8 +27,14 @@ public:
     void setLastName(const QString& lastName) { m_lastName = lastName; }
     void setBirthDate(const QDate& birthDate) { m_birthDate = birthDate; }
     
+    // Совпадение ФИО и даты рождения (id не учитывается)
     bool operator==(const Student& other) const;
     
+    // Порядок по ФИО: фамилия, имя, отчество по кодовым точкам, как побайтное
+    // сравнение UTF-8 на сервере; строки не создаются
+    bool operator<(const Student& other) const { return compareNames(*this, other) < 0; }
+    static int compareNames(const Student& left, const Student& right);
+    
 private:
     int m_id;
     QString m_firstName;
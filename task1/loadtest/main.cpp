@@ -0,0 +1,383 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QMap>
+#include <QMutex>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include "RosterGenerator.h"
+#include "StudentParser.h"
+#include "ZmqClient.h"
+#include "ZmqServer.h"
+
+namespace {
+
+// Время внесения изменений по версиям списка; пишет основной поток, читают подписчики
+class InjectionLog
+{
+public:
+    void add(quint64 version, qint64 ns)
+    {
+        QMutexLocker locker(&m_mutex);
+        m_times.insert(version, ns);
+    }
+    
+    // Задержки всех изменений с версиями из (fromVersion, toVersion]
+    void latencies(quint64 fromVersion, quint64 toVersion, qint64 now, QList<qint64>& out) const
+    {
+        QMutexLocker locker(&m_mutex);
+        for (auto it = m_times.upperBound(fromVersion); it != m_times.cend() && it.key() <= toVersion; ++it) {
+            out.append(now - it.value());
+        }
+    }
+    
+    quint64 lastVersion() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_times.isEmpty() ? 0 : m_times.lastKey();
+    }
+    
+private:
+    mutable QMutex m_mutex;
+    QMap<quint64, qint64> m_times;
+};
+
+// Состояние подписчика меняется только в его потоке и читается после остановки потоков
+struct Subscriber
+{
+    ZmqClient* client = nullptr;
+    quint64 seenVersion = 0;
+    qint64 firstRosterNs = -1;
+    QList<qint64> latencies;
+};
+
+qint64 threadCpuNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+qint64 processCpuNs()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+            usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000;
+}
+
+qint64 percentile(QList<qint64> values, double fraction)
+{
+    if (values.isEmpty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(qMin(values.size() - 1, qsizetype(double(values.size()) * fraction)));
+}
+
+QJsonObject distribution(const QList<qint64>& values)
+{
+    QJsonObject result;
+    result.insert("count", qint64(values.size()));
+    result.insert("p50", percentile(values, 0.50));
+    result.insert("p90", percentile(values, 0.90));
+    result.insert("p99", percentile(values, 0.99));
+    result.insert("max", percentile(values, 1.0));
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("Student Pub/Sub Load Test");
+    app.setApplicationVersion("1.0");
+    
+    qRegisterMetaType<QList<Student>>("QList<Student>");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs ZmqServer and many ZmqClient subscribers in one process");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    
+    QCommandLineOption subscribersOption({"n", "subscribers"}, "Number of subscribers", "count", "100");
+    QCommandLineOption threadsOption({"t", "threads"}, "Subscriber threads", "count",
+                                     QString::number(qMax(1, QThread::idealThreadCount() - 1)));
+    QCommandLineOption transportOption("transport", "tcp, ipc or inproc", "transport", "tcp");
+    QCommandLineOption portOption("port", "TCP port for the tcp transport", "port", "5599");
+    QCommandLineOption ioThreadsOption("io-threads", "ZeroMQ I/O threads of the shared context", "count", "2");
+    QCommandLineOption recordsOption("records", "Generated roster size", "count", "10000");
+    QCommandLineOption changesOption("changes", "Number of roster changes to inject", "count", "50");
+    QCommandLineOption changeSizeOption("change-size", "Students replaced by each change", "count", "100");
+    QCommandLineOption changeIntervalOption("change-interval", "Pause between changes in ms", "ms", "200");
+    QCommandLineOption warmupOption("warmup", "Time for subscribers to connect and sync in ms", "ms", "2000");
+    QCommandLineOption publishIntervalOption("publish-interval", "Server publish tick in ms", "ms", "1000");
+    QCommandLineOption snapshotIntervalOption("snapshot-interval", "Full snapshot every N ticks", "ticks", "5");
+    QCommandLineOption partitionsOption("partitions", "Roster partitions", "count", "1");
+    QCommandLineOption jsonOption("json", "Write results as JSON to the file (\"-\" for stdout)", "file");
+    QCommandLineOption logRulesOption("log-rules", "Logging rules; by default roster logging is off", "rules");
+    parser.addOptions({subscribersOption, threadsOption, transportOption, portOption, ioThreadsOption,
+                       recordsOption, changesOption, changeSizeOption, changeIntervalOption, warmupOption,
+                       publishIntervalOption, snapshotIntervalOption, partitionsOption,
+                       jsonOption, logRulesOption});
+    parser.process(app);
+    
+    QLoggingCategory::setFilterRules(parser.isSet(logRulesOption)
+                                         ? parser.value(logRulesOption).replace(';', '\n')
+                                         : QString("roster.*=false"));
+    
+    const int subscriberCount = qMax(1, parser.value(subscribersOption).toInt());
+    const int threadCount = qBound(1, parser.value(threadsOption).toInt(), subscriberCount);
+    const int changeCount = qMax(0, parser.value(changesOption).toInt());
+    const QString transport = parser.value(transportOption);
+    
+    QString endpoint;
+    if (transport == "tcp") {
+        endpoint = QString("tcp://127.0.0.1:%1").arg(parser.value(portOption));
+    } else if (transport == "ipc") {
+        endpoint = QString("ipc:///tmp/task1-loadtest-%1").arg(getpid());
+    } else if (transport == "inproc") {
+        endpoint = "inproc://task1-loadtest";
+    } else {
+        qCritical() << "Unknown transport" << transport;
+        return 1;
+    }
+    
+    // Исходный список и изменения берутся из генератора бенчмарков
+    RosterGenerator::Options rosterOptions;
+    rosterOptions.records = parser.value(recordsOption).toLongLong();
+    rosterOptions.invalidRatio = 0;
+    RosterGenerator rosterGenerator(rosterOptions);
+    
+    QTemporaryFile rosterFile;
+    const QByteArray roster = rosterGenerator.generate();
+    if (!rosterFile.open() || rosterFile.write(roster) != roster.size() || !rosterFile.flush()) {
+        qCritical() << "Cannot write generated roster to" << rosterFile.fileName();
+        return 1;
+    }
+    
+    RosterGenerator::Options changeOptions;
+    changeOptions.records = qMax(1, parser.value(changeSizeOption).toInt());
+    changeOptions.duplicateRatio = 0;
+    changeOptions.invalidRatio = 0;
+    
+    // inproc работает только внутри одного контекста, поэтому контекст общий для всех
+    zmq::context_t context(qMax(1, parser.value(ioThreadsOption).toInt()));
+    
+    ZmqServer server(endpoint);
+    server.setContext(&context);
+    server.setInputFiles({rosterFile.fileName()});
+    server.setPublishInterval(parser.value(publishIntervalOption).toInt());
+    server.setSnapshotInterval(parser.value(snapshotIntervalOption).toInt());
+    server.setPartitionCount(quint32(qMax(1, parser.value(partitionsOption).toInt())));
+    server.start();
+    
+    // CPU потока публикации можно прочитать только в нем самом
+    QObject publisherProbe;
+    publisherProbe.moveToThread(server.publisherThread());
+    const auto publisherCpuNs = [&publisherProbe]() {
+        qint64 ns = 0;
+        QMetaObject::invokeMethod(&publisherProbe, [&ns]() { ns = threadCpuNs(); }, Qt::BlockingQueuedConnection);
+        return ns;
+    };
+    
+    QElapsedTimer clock;
+    clock.start();
+    InjectionLog injections;
+    
+    QList<QThread*> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.append(new QThread());
+        threads.last()->start();
+    }
+    
+    QList<Subscriber*> subscribers;
+    for (int i = 0; i < subscriberCount; ++i) {
+        auto* subscriber = new Subscriber();
+        subscriber->client = new ZmqClient(endpoint);
+        subscriber->client->setContext(&context);
+        subscriber->client->moveToThread(threads[i % threadCount]);
+        subscribers.append(subscriber);
+        
+        // Обработчик выполняется в потоке клиента сразу после применения сообщения
+        QObject::connect(subscriber->client, &ZmqClient::rosterUpdated, subscriber->client,
+                         [subscriber, &clock, &injections](const RosterView&) {
+                             const qint64 now = clock.nsecsElapsed();
+                             const quint64 version = subscriber->client->rosterVersion();
+                             if (subscriber->firstRosterNs < 0) {
+                                 subscriber->firstRosterNs = now;
+                             }
+                             if (version > subscriber->seenVersion) {
+                                 injections.latencies(subscriber->seenVersion, version, now, subscriber->latencies);
+                                 subscriber->seenVersion = version;
+                             }
+                         }, Qt::DirectConnection);
+        
+        ZmqClient* client = subscriber->client;
+        QMetaObject::invokeMethod(client, [client]() { client->start(); }, Qt::QueuedConnection);
+    }
+    
+    qInfo().noquote() << QString("Load test: %1 subscribers on %2 threads over %3, %4 students, %5 changes of %6")
+                             .arg(subscriberCount).arg(threadCount).arg(endpoint).arg(rosterOptions.records)
+                             .arg(changeCount).arg(changeOptions.records);
+    
+    int injected = 0;
+    qint64 measureStartNs = 0;
+    qint64 publisherCpuStart = 0;
+    qint64 processCpuStart = 0;
+    qint64 publisherCpuUsed = 0;
+    qint64 processCpuUsed = 0;
+    qint64 measureNs = 0;
+    
+    QTimer changeTimer;
+    changeTimer.setInterval(qMax(1, parser.value(changeIntervalOption).toInt()));
+    
+    QObject::connect(&changeTimer, &QTimer::timeout, [&]() {
+        if (injected == changeCount) {
+            changeTimer.stop();
+            
+            // Время на доставку последнего изменения и снимка
+            QTimer::singleShot(qMax(1000, server.publishInterval() * 2), [&]() {
+                measureNs = clock.nsecsElapsed() - measureStartNs;
+                publisherCpuUsed = publisherCpuNs() - publisherCpuStart;
+                processCpuUsed = processCpuNs() - processCpuStart;
+                app.quit();
+            });
+            return;
+        }
+        
+        changeOptions.seed = quint32(injected + 1);
+        RosterGenerator changeGenerator(changeOptions);
+        const QByteArray changeData = changeGenerator.generate();
+        QTemporaryFile changeFile;
+        if (!changeFile.open() || changeFile.write(changeData) != changeData.size() || !changeFile.flush()) {
+            qCritical() << "Cannot write generated change to" << changeFile.fileName();
+            changeTimer.stop();
+            app.exit(1);
+            return;
+        }
+        
+        // Разбор изменения не входит в замер: время отсчитывается от внесения в список
+        const StudentStore students = StudentParser().parseFile(changeFile.fileName());
+        const qint64 now = clock.nsecsElapsed();
+        const quint64 version = server.updateFile("loadtest-changes", students);
+        injections.add(version, now);
+        ++injected;
+    });
+    
+    QTimer::singleShot(qMax(0, parser.value(warmupOption).toInt()), [&]() {
+        measureStartNs = clock.nsecsElapsed();
+        publisherCpuStart = publisherCpuNs();
+        processCpuStart = processCpuNs();
+        changeTimer.start();
+    });
+    
+    const int exitCode = app.exec();
+    
+    // Клиенты останавливаются в своих потоках, после чего их данные можно читать
+    for (Subscriber* subscriber : std::as_const(subscribers)) {
+        ZmqClient* client = subscriber->client;
+        QMetaObject::invokeMethod(client, [client]() { client->stop(); }, Qt::BlockingQueuedConnection);
+    }
+    for (QThread* thread : std::as_const(threads)) {
+        thread->quit();
+        thread->wait();
+    }
+    server.stop();
+    
+    // Прерванный прогон не дает осмысленных замеров
+    if (exitCode != 0) {
+        return exitCode;
+    }
+    
+    QList<qint64> latencies;
+    QList<qint64> throughput;
+    QList<qint64> syncTimes;
+    quint64 dropped = 0;
+    quint64 gaps = 0;
+    int stale = 0;
+    const quint64 lastVersion = injections.lastVersion();
+    
+    for (const Subscriber* subscriber : std::as_const(subscribers)) {
+        const ZmqClient::ReceiveStats& stats = subscriber->client->receiveStats();
+        latencies.append(subscriber->latencies);
+        throughput.append(qint64(double(stats.bytes) * 1e9 / double(qMax<qint64>(1, clock.nsecsElapsed()))));
+        if (subscriber->firstRosterNs >= 0) {
+            syncTimes.append(subscriber->firstRosterNs);
+        }
+        dropped += stats.droppedMessages;
+        gaps += stats.sequenceGaps;
+        if (subscriber->seenVersion < lastVersion) {
+            ++stale;
+        }
+    }
+    
+    const double seconds = double(qMax<qint64>(1, measureNs)) / 1e9;
+    qInfo().noquote() << QString("Propagation latency ms: p50 %1  p90 %2  p99 %3  max %4  (%5 samples)")
+                             .arg(double(percentile(latencies, 0.50)) / 1e6, 0, 'f', 2)
+                             .arg(double(percentile(latencies, 0.90)) / 1e6, 0, 'f', 2)
+                             .arg(double(percentile(latencies, 0.99)) / 1e6, 0, 'f', 2)
+                             .arg(double(percentile(latencies, 1.0)) / 1e6, 0, 'f', 2)
+                             .arg(latencies.size());
+    qInfo().noquote() << QString("Publisher thread CPU: %1%  process CPU: %2%")
+                             .arg(100.0 * double(publisherCpuUsed) / 1e9 / seconds, 0, 'f', 1)
+                             .arg(100.0 * double(processCpuUsed) / 1e9 / seconds, 0, 'f', 1);
+    qInfo().noquote() << QString("Dropped messages: %1  sequence gaps: %2  subscribers behind: %3 of %4")
+                             .arg(dropped).arg(gaps).arg(stale).arg(subscriberCount);
+    qInfo().noquote() << QString("Per-subscriber throughput KB/s: p50 %1  min %2  max %3")
+                             .arg(double(percentile(throughput, 0.50)) / 1e3, 0, 'f', 1)
+                             .arg(double(percentile(throughput, 0.0)) / 1e3, 0, 'f', 1)
+                             .arg(double(percentile(throughput, 1.0)) / 1e3, 0, 'f', 1);
+    
+    if (parser.isSet(jsonOption)) {
+        QJsonObject config;
+        config.insert("subscribers", subscriberCount);
+        config.insert("threads", threadCount);
+        config.insert("endpoint", endpoint);
+        config.insert("records", qint64(rosterOptions.records));
+        config.insert("changes", changeCount);
+        config.insert("change_size", qint64(changeOptions.records));
+        config.insert("partitions", parser.value(partitionsOption).toInt());
+        
+        QJsonObject report;
+        report.insert("config", config);
+        report.insert("latency_ns", distribution(latencies));
+        report.insert("sync_ns", distribution(syncTimes));
+        report.insert("subscriber_bytes_per_sec", distribution(throughput));
+        report.insert("publisher_cpu_ratio", double(publisherCpuUsed) / 1e9 / seconds);
+        report.insert("process_cpu_ratio", double(processCpuUsed) / 1e9 / seconds);
+        report.insert("dropped_messages", qint64(dropped));
+        report.insert("sequence_gaps", qint64(gaps));
+        report.insert("subscribers_behind", stale);
+        
+        const QString path = parser.value(jsonOption);
+        QFile output(path);
+        const bool opened = path == "-" ? output.open(stdout, QIODevice::WriteOnly)
+                                        : output.open(QIODevice::WriteOnly);
+        if (!opened) {
+            qCritical() << "Cannot write results to" << path;
+            return 1;
+        }
+        output.write(QJsonDocument(report).toJson());
+    }
+    
+    for (Subscriber* subscriber : std::as_const(subscribers)) {
+        delete subscriber->client;
+        delete subscriber;
+    }
+    qDeleteAll(threads);
+    
+    return stale == 0 ? 0 : 2;
+}
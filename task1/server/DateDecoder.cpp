@@ -0,0 +1,69 @@
+#include "DateDecoder.h"
+
+namespace {
+
+const unsigned char kDaysInMonth[13] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+inline unsigned digit(unsigned char c)
+{
+    return unsigned(c) - unsigned('0');
+}
+
+inline qint64 decodeOne(const unsigned char* p, qsizetype size)
+{
+    if (size < 8 || size > 10) {
+        return DateDecoder::InvalidDay;
+    }
+    
+    // Позиции точек: день и месяц занимают одну или две цифры, год - ровно четыре
+    const unsigned dayLength = p[1] == '.' ? 1 : 2;
+    const unsigned monthEnd = p[dayLength + 2] == '.' ? dayLength + 2 : dayLength + 3;
+    if (qsizetype(monthEnd + 5) != size) {
+        return DateDecoder::InvalidDay;
+    }
+    
+    const unsigned d0 = digit(p[0]);
+    const unsigned d1 = dayLength == 2 ? digit(p[1]) : 0;
+    const unsigned m0 = digit(p[dayLength + 1]);
+    const unsigned m1 = monthEnd == dayLength + 3 ? digit(p[dayLength + 2]) : 0;
+    const unsigned y0 = digit(p[monthEnd + 1]);
+    const unsigned y1 = digit(p[monthEnd + 2]);
+    const unsigned y2 = digit(p[monthEnd + 3]);
+    const unsigned y3 = digit(p[monthEnd + 4]);
+    
+    bool valid = (p[dayLength] == '.') & (p[monthEnd] == '.');
+    valid &= (d0 <= 9) & (d1 <= 9) & (m0 <= 9) & (m1 <= 9);
+    valid &= (y0 <= 9) & (y1 <= 9) & (y2 <= 9) & (y3 <= 9);
+    
+    const unsigned day = dayLength == 2 ? d0 * 10 + d1 : d0;
+    const unsigned month = monthEnd == dayLength + 3 ? m0 * 10 + m1 : m0;
+    const unsigned year = y0 * 1000 + y1 * 100 + y2 * 10 + y3;
+    
+    const bool leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+    const bool monthValid = (month >= 1) & (month <= 12);
+    const unsigned daysInMonth = kDaysInMonth[monthValid ? month : 0] + ((month == 2) & leap);
+    
+    valid &= monthValid & (day >= 1) & (day <= daysInMonth) & (year >= 1);
+    
+    // Юлианский день для пролептического григорианского календаря, как в QDate
+    const qint64 a = (14 - qint64(month)) / 12;
+    const qint64 y = qint64(year) + 4800 - a;
+    const qint64 m = qint64(month) + 12 * a - 3;
+    const qint64 julianDay = day + (153 * m + 2) / 5 + 365 * y + y / 4 - y / 100 + y / 400 - 32045;
+    
+    return valid ? julianDay : DateDecoder::InvalidDay;
+}
+
+} // namespace
+
+qint64 DateDecoder::decode(QByteArrayView text)
+{
+    return decodeOne(reinterpret_cast<const unsigned char*>(text.data()), text.size());
+}
+
+void DateDecoder::decodeColumn(const QByteArrayView* fields, qsizetype count, qint64* days)
+{
+    for (qsizetype i = 0; i < count; ++i) {
+        days[i] = decodeOne(reinterpret_cast<const unsigned char*>(fields[i].data()), fields[i].size());
+    }
+}
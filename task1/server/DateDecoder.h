@@ -0,0 +1,17 @@
+#ifndef DATEDECODER_H
+#define DATEDECODER_H
+
+#include <QByteArrayView>
+#include <limits>
+
+// Декодер дат вида d.M.yyyy / dd.MM.yyyy напрямую в юлианский день
+class DateDecoder
+{
+public:
+    static constexpr qint64 InvalidDay = std::numeric_limits<qint64>::min();
+    
+    static qint64 decode(QByteArrayView text);
+    static void decodeColumn(const QByteArrayView* fields, qsizetype count, qint64* days);
+};
+
+#endif // DATEDECODER_H
@@ -0,0 +1,141 @@
+#include "DedupIndex.h"
+#include "StudentStore.h"
+
+namespace {
+
+const quint64 kFnvOffset = 0xcbf29ce484222325ULL;
+const quint64 kFnvPrime = 0x100000001b3ULL;
+
+quint64 hashField(quint64 hash, QByteArrayView text)
+{
+    for (char c : text) {
+        hash ^= uchar(c);
+        hash *= kFnvPrime;
+    }
+    // Разделитель полей: байт 0xFF не встречается в корректном UTF-8
+    hash ^= 0xFF;
+    hash *= kFnvPrime;
+    return hash;
+}
+
+quint64 finalize(quint64 hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+} // namespace
+
+DedupIndex::DedupIndex()
+    : m_size(0)
+{
+}
+
+quint64 DedupIndex::fingerprint(const StudentRow& student)
+{
+    quint64 hash = kFnvOffset;
+    hash = hashField(hash, student.firstName);
+    hash = hashField(hash, student.middleName);
+    hash = hashField(hash, student.lastName);
+    hash ^= quint64(qint64(student.julianDay));
+    hash *= kFnvPrime;
+    
+    hash = finalize(hash);
+    // Ноль обозначает пустой слот
+    return hash ? hash : 1;
+}
+
+quint64 DedupIndex::hashBytes(QByteArrayView text)
+{
+    const quint64 hash = finalize(hashField(kFnvOffset, text));
+    return hash ? hash : 1;
+}
+
+void DedupIndex::remove(quint64 fingerprint, qsizetype row)
+{
+    if (m_slots.isEmpty()) {
+        return;
+    }
+    
+    Slot* slots = m_slots.data();
+    const qsizetype mask = m_slots.size() - 1;
+    qsizetype hole = qsizetype(fingerprint & quint64(mask));
+    
+    while (slots[hole].fingerprint != fingerprint || slots[hole].row != row) {
+        if (slots[hole].fingerprint == 0) {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+    
+    // Сдвигаем следующие записи цепочки назад, чтобы поиск не обрывался на дыре
+    qsizetype i = hole;
+    while (true) {
+        i = (i + 1) & mask;
+        if (slots[i].fingerprint == 0) {
+            break;
+        }
+        
+        const qsizetype home = qsizetype(slots[i].fingerprint & quint64(mask));
+        const bool reachable = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+        if (!reachable) {
+            slots[hole] = slots[i];
+            hole = i;
+        }
+    }
+    
+    slots[hole].fingerprint = 0;
+    --m_size;
+}
+
+void DedupIndex::remapRows(const QList<qsizetype>& newRows)
+{
+    for (Slot& slot : m_slots) {
+        if (slot.fingerprint != 0) {
+            slot.row = newRows.at(slot.row);
+        }
+    }
+}
+
+void DedupIndex::reserve(qsizetype count)
+{
+    qsizetype capacity = 16;
+    while (capacity < count * 2) {
+        capacity *= 2;
+    }
+    
+    if (capacity > m_slots.size()) {
+        rehash(capacity);
+    }
+}
+
+void DedupIndex::clear()
+{
+    m_slots.clear();
+    m_size = 0;
+}
+
+void DedupIndex::rehash(qsizetype capacity)
+{
+    QList<Slot> slots(capacity, Slot{0, 0});
+    const qsizetype mask = capacity - 1;
+    
+    // Отпечатки хранятся в таблице, поэтому строки повторно не хешируются
+    for (const Slot& slot : std::as_const(m_slots)) {
+        if (slot.fingerprint == 0) {
+            continue;
+        }
+        
+        qsizetype i = qsizetype(slot.fingerprint & quint64(mask));
+        while (slots[i].fingerprint != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+    
+    m_slots.swap(slots);
+}
@@ -0,0 +1,93 @@
+#ifndef DEDUPINDEX_H
+#define DEDUPINDEX_H
+
+#include <QByteArrayView>
+#include <QList>
+
+struct StudentRow;
+
+// Индекс дубликатов с открытой адресацией по 64-битному отпечатку ФИО и даты рождения.
+// Строки сравниваются только при совпадении отпечатков.
+class DedupIndex
+{
+public:
+    DedupIndex();
+    
+    static quint64 fingerprint(const StudentRow& student);
+    static quint64 hashBytes(QByteArrayView text);
+    
+    // Возвращает строку уже имеющегося дубликата или -1, если запись добавлена как новая
+    template<typename Equal>
+    qsizetype findOrInsert(quint64 fingerprint, qsizetype row, Equal equal);
+    
+    template<typename Equal>
+    qsizetype find(quint64 fingerprint, Equal equal) const;
+    
+    void remove(quint64 fingerprint, qsizetype row);
+    void remapRows(const QList<qsizetype>& newRows);
+    
+    void reserve(qsizetype count);
+    void clear();
+    qsizetype size() const { return m_size; }
+    
+private:
+    struct Slot
+    {
+        quint64 fingerprint;
+        qsizetype row;
+    };
+    
+    QList<Slot> m_slots;
+    qsizetype m_size;
+    
+    void rehash(qsizetype capacity);
+};
+
+template<typename Equal>
+qsizetype DedupIndex::findOrInsert(quint64 fingerprint, qsizetype row, Equal equal)
+{
+    if ((m_size + 1) * 2 > m_slots.size()) {
+        rehash(qMax<qsizetype>(16, m_slots.size() * 2));
+    }
+    
+    Slot* slots = m_slots.data();
+    const qsizetype mask = m_slots.size() - 1;
+    qsizetype i = qsizetype(fingerprint & quint64(mask));
+    
+    while (true) {
+        Slot& slot = slots[i];
+        if (slot.fingerprint == 0) {
+            slot.fingerprint = fingerprint;
+            slot.row = row;
+            ++m_size;
+            return -1;
+        }
+        if (slot.fingerprint == fingerprint && equal(slot.row)) {
+            return slot.row;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+template<typename Equal>
+qsizetype DedupIndex::find(quint64 fingerprint, Equal equal) const
+{
+    if (m_slots.isEmpty()) {
+        return -1;
+    }
+    
+    const Slot* slots = m_slots.constData();
+    const qsizetype mask = m_slots.size() - 1;
+    qsizetype i = qsizetype(fingerprint & quint64(mask));
+    
+    while (slots[i].fingerprint != 0) {
+        if (slots[i].fingerprint == fingerprint && equal(slots[i].row)) {
+            return slots[i].row;
+        }
+        i = (i + 1) & mask;
+    }
+    
+    return -1;
+}
+
+#endif // DEDUPINDEX_H
@@ -0,0 +1,300 @@
+#include "NearDuplicateFinder.h"
+#include "StudentStore.h"
+#include <QDate>
+#include <QHash>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace {
+
+// Блок больше этого сравнивается не попарно, а со скользящим окном по
+// отсортированным записям: частая фамилия не дает квадратичного времени
+const qsizetype kMaxBlockSize = 64;
+const qsizetype kWindowSize = 16;
+
+enum BlockKind : quint64
+{
+    FullNameBlock = 1,
+    PhoneticBlock,
+    GivenNamesBlock,
+    LastNameYearBlock
+};
+
+const quint64 kFnvOffset = 0xcbf29ce484222325ULL;
+const quint64 kFnvPrime = 0x100000001b3ULL;
+
+quint64 mix(quint64 hash, quint64 value)
+{
+    hash ^= value;
+    hash *= kFnvPrime;
+    return hash;
+}
+
+quint64 mix(quint64 hash, QStringView text)
+{
+    for (QChar c : text) {
+        hash = mix(hash, c.unicode());
+    }
+    // Разделитель полей вне диапазона UTF-16
+    return mix(hash, 0x10000);
+}
+
+// Совпадение ключей разных блоков дает только лишние сравнения
+template<typename... Parts>
+quint64 blockKey(BlockKind kind, Parts... parts)
+{
+    quint64 hash = mix(kFnvOffset, quint64(kind));
+    ((hash = mix(hash, parts)), ...);
+    return hash;
+}
+
+// Пара звонкой и глухой согласной; гласные и знаки - 0
+char16_t phoneticClass(char16_t c)
+{
+    switch (c) {
+    case u'а': case u'е': case u'и': case u'о': case u'у': case u'ы': case u'э': case u'ю': case u'я':
+    case u'ъ': case u'ь':
+    case u'a': case u'e': case u'i': case u'o': case u'u': case u'y': case u'h': case u'w':
+        return 0;
+    case u'б': return u'п';
+    case u'в': return u'ф';
+    case u'г': return u'к';
+    case u'д': return u'т';
+    case u'ж': return u'ш';
+    case u'з': return u'с';
+    case u'щ': return u'ш';
+    case u'b': return u'p';
+    case u'd': return u't';
+    case u'g': return u'k';
+    case u'v': return u'f';
+    case u'z': return u's';
+    case u'c': return u'k';
+    case u'q': return u'k';
+    default:
+        return c;
+    }
+}
+
+} // namespace
+
+NearDuplicateFinder::NearDuplicateFinder(int maxEdits)
+    : m_maxEdits(qMax(0, maxEdits))
+    , m_comparisons(0)
+{
+}
+
+void NearDuplicateFinder::reserve(qsizetype count)
+{
+    m_entries.reserve(count);
+    m_blocks.reserve(count * 4);
+}
+
+QString NearDuplicateFinder::normalize(QByteArrayView name)
+{
+    const QString folded = QString::fromUtf8(name).toCaseFolded();
+    QString result;
+    result.reserve(folded.size());
+    
+    for (QChar c : folded) {
+        if (!c.isLetter()) {
+            continue;
+        }
+        if (c == u'ё') {
+            c = u'е';
+        } else if (c == u'й') {
+            c = u'и';
+        }
+        result.append(c);
+    }
+    
+    return result;
+}
+
+QString NearDuplicateFinder::phonetic(QStringView normalized)
+{
+    QString result;
+    result.reserve(normalized.size());
+    
+    char16_t last = 0;
+    for (qsizetype i = 0; i < normalized.size(); ++i) {
+        const char16_t c = normalized[i].unicode();
+        const char16_t mapped = i == 0 ? c : phoneticClass(c);
+        if (mapped != 0 && mapped != last) {
+            result.append(QChar(mapped));
+        }
+        last = mapped;
+    }
+    
+    return result;
+}
+
+int NearDuplicateFinder::editDistance(QStringView left, QStringView right, int limit)
+{
+    if (qAbs(left.size() - right.size()) > limit) {
+        return limit + 1;
+    }
+    if (left == right) {
+        return 0;
+    }
+    
+    QVarLengthArray<int, 64> previous(right.size() + 1);
+    QVarLengthArray<int, 64> current(right.size() + 1);
+    std::iota(previous.begin(), previous.end(), 0);
+    
+    for (qsizetype i = 1; i <= left.size(); ++i) {
+        current[0] = int(i);
+        int best = current[0];
+        for (qsizetype j = 1; j <= right.size(); ++j) {
+            const int cost = left[i - 1] == right[j - 1] ? 0 : 1;
+            current[j] = std::min({previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost});
+            best = qMin(best, current[j]);
+        }
+        // Расстояние не меньше минимума строки: дальше считать бесполезно
+        if (best > limit) {
+            return limit + 1;
+        }
+        std::swap(previous, current);
+    }
+    
+    return qMin(previous[right.size()], limit + 1);
+}
+
+void NearDuplicateFinder::add(quint32 key, const StudentRow& student)
+{
+    Entry entry;
+    entry.key = key;
+    entry.firstName = normalize(student.firstName);
+    entry.middleName = normalize(student.middleName);
+    entry.lastName = normalize(student.lastName);
+    entry.julianDay = student.julianDay;
+    QDate::fromJulianDay(student.julianDay).getDate(&entry.year, &entry.month, &entry.day);
+    
+    const qsizetype index = m_entries.size();
+    const quint64 day = quint64(qint64(entry.julianDay));
+    
+    m_blocks.append({blockKey(FullNameBlock, QStringView(entry.lastName), QStringView(entry.firstName),
+                              QStringView(entry.middleName)), index});
+    m_blocks.append({blockKey(PhoneticBlock, QStringView(phonetic(entry.lastName)), day), index});
+    m_blocks.append({blockKey(GivenNamesBlock, QStringView(entry.firstName), QStringView(entry.middleName), day), index});
+    m_blocks.append({blockKey(LastNameYearBlock, QStringView(entry.lastName), quint64(qint64(entry.year))), index});
+    
+    m_entries.append(std::move(entry));
+}
+
+int NearDuplicateFinder::dateDistance(const Entry& left, const Entry& right) const
+{
+    if (left.julianDay == right.julianDay) {
+        return 0;
+    }
+    // Переставленные день и месяц - одна правка
+    if (left.year == right.year && left.day == right.month && left.month == right.day) {
+        return 1;
+    }
+    return int(left.year != right.year) + int(left.month != right.month) + int(left.day != right.day);
+}
+
+bool NearDuplicateFinder::isNear(const Entry& left, const Entry& right)
+{
+    ++m_comparisons;
+    
+    int budget = m_maxEdits - dateDistance(left, right);
+    if (budget < 0) {
+        return false;
+    }
+    
+    for (auto field : {&Entry::lastName, &Entry::firstName, &Entry::middleName}) {
+        budget -= editDistance(left.*field, right.*field, budget);
+        if (budget < 0) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+QList<QList<quint32>> NearDuplicateFinder::clusters()
+{
+    // Запись попадает в кластер через любую пару, найденную в любом блоке
+    QList<qsizetype> parents(m_entries.size());
+    std::iota(parents.begin(), parents.end(), 0);
+    
+    const auto find = [&parents](qsizetype index) {
+        while (parents[index] != index) {
+            parents[index] = parents[parents[index]];
+            index = parents[index];
+        }
+        return index;
+    };
+    
+    const auto compare = [&](qsizetype left, qsizetype right) {
+        const qsizetype leftRoot = find(left);
+        const qsizetype rightRoot = find(right);
+        if (leftRoot != rightRoot && isNear(m_entries[left], m_entries[right])) {
+            parents[qMax(leftRoot, rightRoot)] = qMin(leftRoot, rightRoot);
+        }
+    };
+    
+    std::sort(m_blocks.begin(), m_blocks.end());
+    
+    QList<qsizetype> block;
+    for (qsizetype begin = 0; begin < m_blocks.size();) {
+        qsizetype end = begin + 1;
+        while (end < m_blocks.size() && m_blocks[end].first == m_blocks[begin].first) {
+            ++end;
+        }
+        
+        block.clear();
+        for (qsizetype i = begin; i < end; ++i) {
+            block.append(m_blocks[i].second);
+        }
+        begin = end;
+        
+        if (block.size() <= kMaxBlockSize) {
+            for (qsizetype i = 0; i < block.size(); ++i) {
+                for (qsizetype j = i + 1; j < block.size(); ++j) {
+                    compare(block[i], block[j]);
+                }
+            }
+            continue;
+        }
+        
+        std::sort(block.begin(), block.end(), [this](qsizetype left, qsizetype right) {
+            const Entry& a = m_entries[left];
+            const Entry& b = m_entries[right];
+            return std::tie(a.lastName, a.firstName, a.middleName, a.julianDay) <
+                   std::tie(b.lastName, b.firstName, b.middleName, b.julianDay);
+        });
+        for (qsizetype i = 0; i < block.size(); ++i) {
+            for (qsizetype j = i + 1; j < qMin(block.size(), i + 1 + kWindowSize); ++j) {
+                compare(block[i], block[j]);
+            }
+        }
+    }
+    
+    // Размеры групп считаются заранее, одиночные записи списков не получают
+    QList<qsizetype> sizes(m_entries.size(), 0);
+    for (qsizetype i = 0; i < m_entries.size(); ++i) {
+        ++sizes[find(i)];
+    }
+    
+    QHash<qsizetype, qsizetype> clusterOf;
+    QList<QList<quint32>> result;
+    for (qsizetype i = 0; i < m_entries.size(); ++i) {
+        const qsizetype root = find(i);
+        if (sizes[root] < 2) {
+            continue;
+        }
+        
+        auto it = clusterOf.constFind(root);
+        if (it == clusterOf.cend()) {
+            it = clusterOf.insert(root, result.size());
+            result.append(QList<quint32>());
+            result.last().reserve(sizes[root]);
+        }
+        result[it.value()].append(m_entries[i].key);
+    }
+    
+    return result;
+}
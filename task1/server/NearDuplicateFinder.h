@@ -0,0 +1,67 @@
+#ifndef NEARDUPLICATEFINDER_H
+#define NEARDUPLICATEFINDER_H
+
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+#include <QStringView>
+
+struct StudentRow;
+
+// Поиск почти дубликатов: записи, отличающиеся не больше чем на maxEdits правок
+// (опечатка в имени или в одной части даты рождения). Попарно сравниваются
+// только записи с общим ключом блока, поэтому время близко к линейному.
+// Ключи блоков:
+// - нормализованное ФИО - опечатка в дате;
+// - фонетический ключ фамилии и дата рождения - опечатка в фамилии, имени или отчестве;
+// - нормализованные имя, отчество и дата рождения - любая опечатка в фамилии;
+// - нормализованная фамилия и год рождения.
+// Пары, у которых нет общего блока (например, опечатки сразу в двух полях), не находятся.
+class NearDuplicateFinder
+{
+public:
+    explicit NearDuplicateFinder(int maxEdits = 1);
+    
+    void reserve(qsizetype count);
+    void add(quint32 key, const StudentRow& student);
+    
+    // Группы ключей почти дубликатов, в каждой не меньше двух ключей
+    QList<QList<quint32>> clusters();
+    
+    qsizetype comparisons() const { return m_comparisons; }
+    
+    // Расстояние Левенштейна; при расстоянии больше limit возвращает limit + 1
+    static int editDistance(QStringView left, QStringView right, int limit);
+    
+    // Регистр, "ё"/"е", "й"/"и" и знаки, кроме букв, не различаются
+    static QString normalize(QByteArrayView name);
+    
+    // Согласные без удвоений, звонкие заменены парными глухими; гласные,
+    // кроме первой буквы, отброшены
+    static QString phonetic(QStringView normalized);
+    
+private:
+    struct Entry
+    {
+        quint32 key;
+        QString firstName;
+        QString middleName;
+        QString lastName;
+        qint32 julianDay;
+        int year;
+        int month;
+        int day;
+    };
+    
+    int m_maxEdits;
+    qsizetype m_comparisons;
+    QList<Entry> m_entries;
+    
+    // Пары (ключ блока, номер записи)
+    QList<std::pair<quint64, qsizetype>> m_blocks;
+    
+    bool isNear(const Entry& left, const Entry& right);
+    int dateDistance(const Entry& left, const Entry& right) const;
+};
+
+#endif // NEARDUPLICATEFINDER_H
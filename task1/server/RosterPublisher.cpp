@@ -0,0 +1,268 @@
+#include "RosterPublisher.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
+#include "StudentManager.h"
+#include <QDebug>
+#include <QRandomGenerator>
+
+namespace {
+
+void releaseBuffer(void* /*data*/, void* hint)
+{
+    delete static_cast<QByteArray*>(hint);
+}
+
+} // namespace
+
+RosterPublisher::RosterPublisher(QObject *parent)
+    : QObject(parent)
+    , m_context(nullptr)
+    , m_socket(nullptr)
+    , m_timer(nullptr)
+    , m_publishInterval(3000)
+    , m_epoch(QRandomGenerator::system()->generate64())
+    , m_snapshotInterval(1)
+    , m_ticksSinceSnapshot(0)
+    , m_publishedVersion(0)
+    , m_requestedVersion(0)
+    , m_snapshotPending(false)
+{
+}
+
+RosterPublisher::~RosterPublisher()
+{
+    stop();
+}
+
+bool RosterPublisher::start()
+{
+    try {
+        m_socket = new zmq::socket_t(*m_context, ZMQ_PUB);
+        // Все адреса обслуживает один сокет, поэтому одно сообщение уходит на все сразу
+        for (const QString& endpoint : std::as_const(m_endpoints)) {
+            m_socket->bind(endpoint.toStdString());
+        }
+    } catch (const zmq::error_t& e) {
+        qCCritical(lcTransport) << "ZMQ error:" << e.what();
+        stop();
+        return false;
+    }
+    
+    // Таймер создается здесь, чтобы принадлежать потоку публикации
+    m_timer = new QTimer(this);
+    m_timer->setInterval(m_publishInterval);
+    connect(m_timer, &QTimer::timeout, this, &RosterPublisher::publishTick);
+    m_timer->start();
+    
+    publish(true);
+    return true;
+}
+
+void RosterPublisher::stop()
+{
+    if (m_timer) {
+        m_timer->stop();
+        delete m_timer;
+        m_timer = nullptr;
+    }
+    
+    if (m_socket) {
+        m_socket->close();
+        delete m_socket;
+        m_socket = nullptr;
+    }
+}
+
+void RosterPublisher::rosterChanged()
+{
+    publish(false);
+}
+
+void RosterPublisher::publishTick()
+{
+    publish(true);
+}
+
+void RosterPublisher::publish(bool timerTick)
+{
+    if (!m_socket) {
+        return;
+    }
+    
+    const RosterStatePtr state = std::atomic_load(&m_state);
+    if (!state) {
+        return;
+    }
+    
+    RosterMetrics::ScopedTimer timer(RosterMetrics::PublishTime);
+    
+    try {
+        if (timerTick) {
+            ++m_ticksSinceSnapshot;
+        }
+        
+        if (m_publishedVersion == 0 || (timerTick && m_ticksSinceSnapshot >= m_snapshotInterval)) {
+            m_snapshotPending = true;
+        }
+        
+        // Пока снимок не готов, изменения по-прежнему уходят дельтами
+        if (m_snapshotPending && publishSnapshot(state)) {
+            return;
+        }
+        
+        // Несколько изменений, пришедших до пробуждения, уходят одной серией дельт
+        if (state->version != m_publishedVersion && !publishDeltas(*state)) {
+            m_snapshotPending = true;
+            publishSnapshot(state);
+        }
+    } catch (const zmq::error_t& e) {
+        qCCritical(lcTransport) << "Error sending message:" << e.what();
+    }
+}
+
+RosterSnapshotPtr RosterPublisher::snapshotFor(const RosterStatePtr& state)
+{
+    if (m_snapshot && m_snapshot->version == state->version) {
+        return m_snapshot;
+    }
+    
+    if (!state->source) {
+        // Копию списка делает основной поток; повторный запрос той же версии не нужен
+        if (m_requestedVersion != state->version) {
+            m_requestedVersion = state->version;
+            emit snapshotRequested();
+        }
+        return nullptr;
+    }
+    
+    m_snapshot = std::make_shared<const RosterSnapshot>(
+        RosterSnapshot{state->version, state->source->serializeStudents()});
+    
+    // Копия больше не нужна: пока она жива, следующее изменение в основном
+    // потоке копировало бы колонки. Новое состояние уже без копии не трогаем
+    auto stripped = std::make_shared<RosterState>(*state);
+    stripped->source.reset();
+    RosterStatePtr expected = state;
+    std::atomic_compare_exchange_strong(&m_state, &expected, RosterStatePtr(std::move(stripped)));
+    
+    return m_snapshot;
+}
+
+bool RosterPublisher::publishSnapshot(const RosterStatePtr& state)
+{
+    const RosterSnapshotPtr snapshotPtr = snapshotFor(state);
+    if (!snapshotPtr) {
+        return false;
+    }
+    
+    const RosterSnapshot& snapshot = *snapshotPtr;
+    
+    // Число разделов известно после первого снимка
+    m_partitionSequences.resize(snapshot.partitions.size(), 0);
+    m_partitionVersions.resize(snapshot.partitions.size(), 0);
+    
+    RosterProtocol::Envelope envelope;
+    envelope.type = RosterProtocol::SnapshotMessage;
+    envelope.version = snapshot.version;
+    
+    for (qsizetype i = 0; i < snapshot.partitions.size(); ++i) {
+        envelope.partition = quint32(i);
+        sendChunks(envelope, snapshot.partitions[i]);
+        m_partitionVersions[i] = snapshot.version;
+    }
+    
+    m_publishedVersion = snapshot.version;
+    m_ticksSinceSnapshot = 0;
+    m_snapshotPending = false;
+    return true;
+}
+
+bool RosterPublisher::publishDeltas(const RosterState& state)
+{
+    // Цепочка должна начинаться с уже опубликованной версии, иначе нужен снимок
+    qsizetype first = 0;
+    while (first < state.deltas.size() && state.deltas[first]->baseVersion != m_publishedVersion) {
+        ++first;
+    }
+    if (first == state.deltas.size()) {
+        return false;
+    }
+    
+    RosterProtocol::Envelope envelope;
+    envelope.type = RosterProtocol::DeltaMessage;
+    
+    for (qsizetype d = first; d < state.deltas.size(); ++d) {
+        const RosterDelta& delta = *state.deltas[d];
+        envelope.version = delta.version;
+        
+        for (qsizetype i = 0; i < delta.partitions.size() && i < m_partitionVersions.size(); ++i) {
+            if (delta.partitions[i].isEmpty()) {
+                continue;
+            }
+            
+            envelope.partition = quint32(i);
+            envelope.baseVersion = m_partitionVersions[i];
+            sendChunks(envelope, delta.partitions[i]);
+            m_partitionVersions[i] = delta.version;
+        }
+        
+        m_publishedVersion = delta.version;
+    }
+    
+    return true;
+}
+
+void RosterPublisher::sendChunks(RosterProtocol::Envelope envelope, const RosterPartition& chunks)
+{
+    envelope.chunkCount = quint32(chunks.size());
+    
+    for (qsizetype i = 0; i < chunks.size(); ++i) {
+        envelope.chunkIndex = quint32(i);
+        envelope.flags = chunks[i].flags;
+        sendMessage(envelope, chunks[i].payload);
+    }
+}
+
+bool RosterPublisher::sendMessage(RosterProtocol::Envelope envelope, const QByteArray& body)
+{
+    if (envelope.partition >= quint32(m_partitionSequences.size())) {
+        qCWarning(lcTransport) << "Partition" << envelope.partition << "is out of range 0 -"
+                   << m_partitionSequences.size() - 1;
+        return false;
+    }
+    
+    // Номер растет и при неудачной отправке, чтобы клиенты заметили пропуск
+    envelope.sequence = ++m_partitionSequences[envelope.partition];
+    envelope.epoch = m_epoch;
+    const QByteArray topic = RosterProtocol::topic(envelope.partition);
+    const QByteArray header = RosterProtocol::encodeEnvelope(envelope);
+    
+    // Сокет PUB сравнивает подписки с первым кадром и не отправляет
+    // подписчику чужие разделы
+    zmq::message_t topicMessage(topic.constData(), topic.size());
+    zmq::message_t headerMessage(header.constData(), header.size());
+    
+    // Тело не копируется: сообщение ссылается на буфер снимка, а ZeroMQ
+    // освобождает ссылку на него, когда кадр отправлен всем подписчикам
+    auto* buffer = new QByteArray(body);
+    zmq::message_t bodyMessage(const_cast<char*>(buffer->constData()), size_t(buffer->size()),
+                               releaseBuffer, buffer);
+    
+    auto topicResult = m_socket->send(topicMessage, zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+    if (!topicResult.has_value()) {
+        qCDebug(lcTransport) << "No subscribers connected";
+        return false;
+    }
+    
+    m_socket->send(headerMessage, zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+    m_socket->send(bodyMessage, zmq::send_flags::dontwait);
+    
+    RosterMetrics::add(RosterMetrics::PublishedMessages);
+    RosterMetrics::add(RosterMetrics::PublishedBytes, quint64(header.size() + body.size()));
+    
+    qCDebug(lcTransport) << "Sent" << (envelope.type == RosterProtocol::DeltaMessage ? "delta" : "snapshot")
+             << "partition" << envelope.partition << "#" << envelope.sequence << "version" << envelope.version
+             << "chunk" << envelope.chunkIndex + 1 << "/" << envelope.chunkCount
+             << "," << body.size() << "bytes with student data";
+    return true;
+}
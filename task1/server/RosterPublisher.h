@@ -0,0 +1,83 @@
+#ifndef ROSTERPUBLISHER_H
+#define ROSTERPUBLISHER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+#include <zmq.hpp>
+#include "RosterProtocol.h"
+#include "RosterSnapshot.h"
+
+// Публикует список из своего потока. Сокет PUB создается и используется
+// только в этом потоке. Новое состояние передается через setState без
+// блокировок; rosterChanged будит поток сразу, таймер публикует снимки.
+// Снимок кодируется здесь же: когда он нужен, издатель просит копию списка
+// сигналом snapshotRequested и ждет состояния, в котором она есть.
+class RosterPublisher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RosterPublisher(QObject *parent = nullptr);
+    ~RosterPublisher();
+    
+    // Настройки задаются до start
+    void setContext(zmq::context_t* context) { m_context = context; }
+    void setEndpoints(const QStringList& endpoints) { m_endpoints = endpoints; }
+    void setPublishInterval(int ms) { m_publishInterval = qMax(1, ms); }
+    int publishInterval() const { return m_publishInterval; }
+    void setSnapshotInterval(int ticks) { m_snapshotInterval = qMax(1, ticks); }
+    int snapshotInterval() const { return m_snapshotInterval; }
+    
+    // Выбирается при создании, см. RosterProtocol::Envelope::epoch
+    quint64 epoch() const { return m_epoch; }
+    
+    // Вызывается из любого потока
+    void setState(const RosterStatePtr& state) { std::atomic_store(&m_state, state); }
+    RosterStatePtr state() const { return std::atomic_load(&m_state); }
+    
+signals:
+    void snapshotRequested();
+
+public slots:
+    bool start();
+    void stop();
+    void rosterChanged();
+
+private slots:
+    void publishTick();
+
+private:
+    void publish(bool timerTick);
+    bool publishSnapshot(const RosterStatePtr& state);
+    RosterSnapshotPtr snapshotFor(const RosterStatePtr& state);
+    bool publishDeltas(const RosterState& state);
+    void sendChunks(RosterProtocol::Envelope envelope, const RosterPartition& chunks);
+    bool sendMessage(RosterProtocol::Envelope envelope, const QByteArray& body);
+    
+    zmq::context_t* m_context;
+    zmq::socket_t* m_socket;
+    QStringList m_endpoints;
+    QTimer* m_timer;
+    int m_publishInterval;
+    RosterStatePtr m_state;
+    quint64 m_epoch;
+    
+    int m_snapshotInterval;
+    int m_ticksSinceSnapshot;
+    quint64 m_publishedVersion;
+    
+    // Последний закодированный снимок; снимок, которого еще нет, запрошен
+    // для версии m_requestedVersion
+    RosterSnapshotPtr m_snapshot;
+    quint64 m_requestedVersion;
+    bool m_snapshotPending;
+    
+    // Номера сообщений и опубликованные версии ведутся по разделам:
+    // подписчик одного раздела не видит сообщений остальных
+    QList<quint64> m_partitionSequences;
+    QList<quint64> m_partitionVersions;
+};
+
+#endif // ROSTERPUBLISHER_H
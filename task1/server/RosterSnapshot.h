@@ -0,0 +1,55 @@
+#ifndef ROSTERSNAPSHOT_H
+#define ROSTERSNAPSHOT_H
+
+#include <QByteArray>
+#include <QList>
+#include <memory>
+
+class StudentManager;
+
+// Закодированная часть сообщения и флаги конверта для нее (сжатие)
+struct RosterChunk
+{
+    quint8 flags;
+    QByteArray payload;
+};
+
+// Части одного раздела списка (см. RosterProtocol::partitionOf)
+using RosterPartition = QList<RosterChunk>;
+
+// Неизменяемый закодированный список студентов определенной версии
+struct RosterSnapshot
+{
+    quint64 version;
+    QList<RosterPartition> partitions;
+};
+
+using RosterSnapshotPtr = std::shared_ptr<const RosterSnapshot>;
+
+// Закодированные изменения от baseVersion до version
+struct RosterDelta
+{
+    quint64 baseVersion;
+    quint64 version;
+    QList<RosterPartition> partitions;
+};
+
+using RosterDeltaPtr = std::shared_ptr<const RosterDelta>;
+
+// Копия списка, по которой поток публикации сам кодирует снимок. Контейнеры
+// разделяются неявно, поэтому копия не копирует данные, пока список не изменится
+using RosterSourcePtr = std::shared_ptr<const StudentManager>;
+
+// То, что потоку публикации передается после каждого изменения списка:
+// версия, непрерывная цепочка дельт, которая к ней ведет, и копия списка
+// этой версии, если поток публикации просил снимок
+struct RosterState
+{
+    quint64 version;
+    QList<RosterDeltaPtr> deltas;
+    RosterSourcePtr source;
+};
+
+using RosterStatePtr = std::shared_ptr<const RosterState>;
+
+#endif // ROSTERSNAPSHOT_H
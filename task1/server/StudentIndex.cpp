@@ -0,0 +1,117 @@
+#include "StudentIndex.h"
+#include "RosterProtocol.h"
+#include <algorithm>
+
+namespace {
+
+template<typename Less>
+void mergeKeys(QList<quint32>& order, QList<quint32> inserted, Less less)
+{
+    std::sort(inserted.begin(), inserted.end(), less);
+    
+    QList<quint32> merged(order.size() + inserted.size());
+    std::merge(order.cbegin(), order.cend(), inserted.cbegin(), inserted.cend(), merged.begin(), less);
+    order.swap(merged);
+}
+
+} // namespace
+
+void StudentIndex::insert(quint32 key, qint32 id)
+{
+    m_byId.insert(id, key);
+    m_inserted.append(key);
+}
+
+void StudentIndex::remove(quint32 key, qint32 id)
+{
+    m_byId.remove(id, key);
+    m_removed.insert(key);
+}
+
+void StudentIndex::updateId(quint32 key, qint32 oldId, qint32 newId)
+{
+    m_byId.remove(oldId, key);
+    m_byId.insert(newId, key);
+}
+
+void StudentIndex::commit(const StudentStore& store)
+{
+    if (!m_removed.isEmpty()) {
+        const auto removed = [this](quint32 key) { return m_removed.contains(key); };
+        m_byName.erase(std::remove_if(m_byName.begin(), m_byName.end(), removed), m_byName.end());
+        m_byDate.erase(std::remove_if(m_byDate.begin(), m_byDate.end(), removed), m_byDate.end());
+        
+        // Строка могла появиться и исчезнуть до commit
+        m_inserted.erase(std::remove_if(m_inserted.begin(), m_inserted.end(), removed), m_inserted.end());
+        m_removed.clear();
+    }
+    
+    if (!m_inserted.isEmpty()) {
+        // Сортируются только новые ключи, с индексом они сливаются за линейное время
+        mergeKeys(m_byName, m_inserted,
+                  [&store](quint32 left, quint32 right) { return nameLess(store, left, right); });
+        mergeKeys(m_byDate, m_inserted,
+                  [&store](quint32 left, quint32 right) { return dateLess(store, left, right); });
+        m_inserted.clear();
+    }
+}
+
+void StudentIndex::rebuild(const StudentStore& store)
+{
+    clear();
+    
+    for (qsizetype row = 0; row < store.size(); ++row) {
+        insert(quint32(row + 1), store.id(row));
+    }
+    
+    commit(store);
+}
+
+void StudentIndex::clear()
+{
+    m_byName.clear();
+    m_byDate.clear();
+    m_byId.clear();
+    m_inserted.clear();
+    m_removed.clear();
+}
+
+std::pair<qsizetype, qsizetype> StudentIndex::lastNamePrefixRange(const StudentStore& store, QByteArrayView prefix) const
+{
+    // Фамилия - первое поле порядка, поэтому фамилии с префиксом идут подряд
+    const auto first = std::partition_point(m_byName.cbegin(), m_byName.cend(), [&](quint32 key) {
+        return RosterProtocol::compareBytes(store.row(qsizetype(key) - 1).lastName, prefix) < 0;
+    });
+    const auto last = std::partition_point(first, m_byName.cend(), [&](quint32 key) {
+        return store.row(qsizetype(key) - 1).lastName.startsWith(prefix);
+    });
+    
+    return {first - m_byName.cbegin(), last - m_byName.cbegin()};
+}
+
+std::pair<qsizetype, qsizetype> StudentIndex::birthDateRange(const StudentStore& store, qint32 fromDay, qint32 toDay) const
+{
+    const auto first = std::partition_point(m_byDate.cbegin(), m_byDate.cend(), [&](quint32 key) {
+        return store.row(qsizetype(key) - 1).julianDay < fromDay;
+    });
+    const auto last = std::partition_point(first, m_byDate.cend(), [&](quint32 key) {
+        return store.row(qsizetype(key) - 1).julianDay <= toDay;
+    });
+    
+    return {first - m_byDate.cbegin(), last - m_byDate.cbegin()};
+}
+
+bool StudentIndex::nameLess(const StudentStore& store, quint32 left, quint32 right)
+{
+    const int result = RosterProtocol::compareNames(store.row(qsizetype(left) - 1),
+                                                    store.row(qsizetype(right) - 1));
+    return result != 0 ? result < 0 : left < right;
+}
+
+bool StudentIndex::dateLess(const StudentStore& store, quint32 left, quint32 right)
+{
+    const qint32 a = store.row(qsizetype(left) - 1).julianDay;
+    const qint32 b = store.row(qsizetype(right) - 1).julianDay;
+    
+    return a != b ? a < b : left < right;
+}
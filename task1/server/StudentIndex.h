@@ -0,0 +1,51 @@
+#ifndef STUDENTINDEX_H
+#define STUDENTINDEX_H
+
+#include <QByteArrayView>
+#include <QList>
+#include <QMultiHash>
+#include <QSet>
+#include <utility>
+#include "StudentStore.h"
+
+// Индексы живых строк StudentManager для запросов: порядок по ФИО, порядок
+// по дате рождения и поиск по id. Хранятся ключи строк (номер + 1), имена и
+// даты читаются из хранилища. Имена и дата строки не меняются, поэтому
+// порядок меняется только при добавлении и удалении строк; они копятся
+// и вливаются в отсортированные массивы одним проходом в commit.
+class StudentIndex
+{
+public:
+    void insert(quint32 key, qint32 id);
+    void remove(quint32 key, qint32 id);
+    void updateId(quint32 key, qint32 oldId, qint32 newId);
+    void commit(const StudentStore& store);
+    
+    // После уплотнения все строки хранилища живые, а ключи другие
+    void rebuild(const StudentStore& store);
+    void clear();
+    
+    qsizetype size() const { return m_byName.size(); }
+    const QList<quint32>& nameOrder() const { return m_byName; }
+    const QList<quint32>& dateOrder() const { return m_byDate; }
+    
+    QList<quint32> findById(qint32 id) const { return m_byId.values(id); }
+    
+    // Полуинтервалы позиций в nameOrder и dateOrder
+    std::pair<qsizetype, qsizetype> lastNamePrefixRange(const StudentStore& store, QByteArrayView prefix) const;
+    std::pair<qsizetype, qsizetype> birthDateRange(const StudentStore& store, qint32 fromDay, qint32 toDay) const;
+    
+    // Фамилия, имя, отчество побайтно (порядок кодовых точек UTF-8), затем ключ
+    static bool nameLess(const StudentStore& store, quint32 left, quint32 right);
+    static bool dateLess(const StudentStore& store, quint32 left, quint32 right);
+    
+private:
+    QList<quint32> m_byName;
+    QList<quint32> m_byDate;
+    QMultiHash<qint32, quint32> m_byId;
+    
+    QList<quint32> m_inserted;
+    QSet<quint32> m_removed;
+};
+
+#endif // STUDENTINDEX_H
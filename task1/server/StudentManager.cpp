@@ -1,77 +1,482 @@
 #include "StudentManager.h"
+#include "NearDuplicateFinder.h"
 #include "StudentParser.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
 #include <QDebug>
-#include <QDataStream>
-#include <QIODevice>
+#include <algorithm>
+
+namespace {
+
+// Если изменений больше, клиентам дешевле получить полный снимок
+const qsizetype kMaxJournalSize = 1 << 20;
+
+// Пустые строки убираются, когда их становится больше живых
+const qsizetype kMinCompactRows = 4096;
+
+// Ответ на запрос не больше этого числа студентов, остальное - следующими страницами
+const quint32 kMaxQueryPage = 1000;
+
+void addStudent(RosterWriter& writer, quint32 key, qint32 id, const StudentRow& student)
+{
+    writer.addUpsert(key, id, student.firstName, student.middleName, student.lastName, student.julianDay);
+}
+
+} // namespace
 
 StudentManager::StudentManager()
+    : m_liveCount(0)
+    , m_useStringTable(false)
+    , m_useCompression(false)
+    , m_presort(true)
+    , m_chunkSize(256 * 1024)
+    , m_partitionCount(1)
+    , m_version(0)
+    , m_journalBaseVersion(0)
 {
 }
 
 void StudentManager::loadStudentsFromFiles(const QStringList& filenames)
 {
-    m_students.clear();
     StudentParser parser;
+    const QList<StudentStore> parsed = parser.parseFiles(filenames);
+    QList<RosterChange> changes;
+    
+    // Файлы, которых нет в новом списке, теряют свой вклад
+    for (int i = 0; i < m_files.size(); ++i) {
+        if (!filenames.contains(m_files[i].filename)) {
+            mergeDuplicates(i, StudentStore(), changes);
+        }
+    }
+    
+    for (qsizetype i = 0; i < filenames.size(); ++i) {
+        mergeDuplicates(fileIndex(filenames[i]), parsed[i], changes);
+        qCInfo(lcParser) << "Loaded" << parsed[i].size() << "students from" << filenames[i];
+    }
+    
+    commitChanges(changes);
+    qCInfo(lcDedup) << "Total unique students:" << m_liveCount << "version" << m_version;
+}
+
+void StudentManager::appendStudentsFromFiles(const QStringList& filenames)
+{
+    StudentParser parser;
+    const QList<StudentStore> parsed = parser.parseFiles(filenames);
+    QList<RosterChange> changes;
     
-    for (const QString& filename : filenames) {
-        QList<Student> fileStudents = parser.parseFile(filename);
-        m_students.append(fileStudents);
-        qDebug() << "Loaded" << fileStudents.size() << "students from" << filename;
+    for (qsizetype i = 0; i < filenames.size(); ++i) {
+        mergeDuplicates(fileIndex(filenames[i]), parsed[i], changes);
+        qCInfo(lcParser) << "Loaded" << parsed[i].size() << "students from" << filenames[i];
     }
     
-    mergeDuplicates();
-    qDebug() << "Total unique students:" << m_students.size();
+    commitChanges(changes);
+    qCInfo(lcDedup) << "Total unique students:" << m_liveCount << "version" << m_version;
+}
+
+void StudentManager::reloadFile(const QString& filename, const StudentStore& students)
+{
+    QList<RosterChange> changes;
+    mergeDuplicates(fileIndex(filename), students, changes);
+    commitChanges(changes);
+    
+    qCInfo(lcDedup) << "Reloaded" << students.size() << "students from" << filename << ","
+             << changes.size() << "changes, total unique students:" << m_liveCount << "version" << m_version;
+}
+
+QStringList StudentManager::filenames() const
+{
+    QStringList result;
+    for (const SourceFile& file : m_files) {
+        result.append(file.filename);
+    }
+    return result;
 }
 
 QList<Student> StudentManager::getUniqueStudents() const
 {
-    return m_students;
+    QList<Student> students;
+    students.reserve(m_liveCount);
+    
+    for (qsizetype row = 0; row < m_students.size(); ++row) {
+        if (m_refCounts.at(row) > 0) {
+            students.append(m_students.toStudent(row));
+        }
+    }
+    
+    return students;
+}
+
+bool StudentManager::changesSince(quint64 version, QList<RosterChange>& changes) const
+{
+    changes.clear();
+    
+    if (version < m_journalBaseVersion || version > m_version) {
+        return false;
+    }
+    
+    auto it = std::upper_bound(m_journal.cbegin(), m_journal.cend(), version,
+                               [](quint64 value, const RosterChange& change) { return value < change.version; });
+    for (; it != m_journal.cend(); ++it) {
+        changes.append(*it);
+    }
+    
+    return true;
+}
+
+QList<RosterPartition> StudentManager::serializeStudents() const
+{
+    RosterMetrics::ScopedTimer timer(RosterMetrics::SerializeTime);
+    QList<RosterWriter> writers;
+    writers.reserve(m_partitionCount);
+    for (quint32 i = 0; i < m_partitionCount; ++i) {
+        writers.emplaceBack(RosterProtocol::SnapshotMessage, m_useStringTable, m_chunkSize);
+        writers.last().setSorted(m_presort);
+    }
+    
+    quint64 count = 0;
+    const auto add = [&](quint32 key, const StudentRow& student) {
+        addStudent(writers[RosterProtocol::partitionOf(student.lastName, m_partitionCount)], key, student.id, student);
+        ++count;
+    };
+    
+    // Раздел - подпоследовательность общего порядка, поэтому каждый раздел тоже упорядочен
+    if (m_presort) {
+        for (quint32 key : m_index.nameOrder()) {
+            add(key, m_students.row(qsizetype(key) - 1));
+        }
+    } else {
+        forEachStudent(add);
+    }
+    
+    // В снимке есть каждый раздел, даже пустой: так подписчик узнает, что он опустел
+    const QList<RosterPartition> partitions = finishPartitions(writers);
+    
+    qsizetype chunks = 0;
+    qsizetype bytes = 0;
+    for (const RosterPartition& partition : partitions) {
+        chunks += partition.size();
+        for (const RosterChunk& chunk : partition) {
+            bytes += chunk.payload.size();
+        }
+    }
+    qCDebug(lcCodec) << "Serialized" << count << "students into" << partitions.size() << "partitions,"
+             << chunks << "chunks," << bytes << "bytes, version" << m_version;
+    
+    return partitions;
+}
+
+QList<RosterPartition> StudentManager::serializeChanges(const QList<RosterChange>& changes) const
+{
+    RosterMetrics::ScopedTimer timer(RosterMetrics::SerializeTime);
+    QList<RosterWriter> writers;
+    writers.reserve(m_partitionCount);
+    for (quint32 i = 0; i < m_partitionCount; ++i) {
+        writers.emplaceBack(RosterProtocol::DeltaMessage, m_useStringTable, m_chunkSize);
+    }
+    
+    // Удаленная строка сохраняет фамилию, раздел удаления считается по ней
+    for (const RosterChange& change : changes) {
+        const StudentRow student = m_students.row(qsizetype(change.key) - 1);
+        RosterWriter& writer = writers[RosterProtocol::partitionOf(student.lastName, m_partitionCount)];
+        if (change.type == RosterProtocol::RemoveChange) {
+            writer.addRemove(change.key);
+        } else {
+            addStudent(writer, change.key, change.id, student);
+        }
+    }
+    
+    return finishPartitions(writers);
 }
 
-QByteArray StudentManager::serializeStudents() const
+bool StudentManager::serializeQuery(const RosterProtocol::Query& query, QByteArray& body, quint64& total) const
 {
-    QByteArray data;
-    QDataStream stream(&data, QIODevice::WriteOnly);
-    stream.setVersion(QDataStream::Qt_5_15);
+    QList<quint32> keys;
+    const QList<quint32>* order = &keys;
+    std::pair<qsizetype, qsizetype> range;
     
-    int count = m_students.size();
-    stream << count;
+    switch (query.type) {
+    case RosterProtocol::QueryById:
+        keys = m_index.findById(query.id);
+        std::sort(keys.begin(), keys.end());
+        range = {0, keys.size()};
+        break;
+    case RosterProtocol::QueryByLastNamePrefix:
+        order = &m_index.nameOrder();
+        range = m_index.lastNamePrefixRange(m_students, query.lastNamePrefix);
+        break;
+    case RosterProtocol::QueryByBirthDateRange:
+        order = &m_index.dateOrder();
+        range = m_index.birthDateRange(m_students, query.fromDay, query.toDay);
+        break;
+    case RosterProtocol::QueryPage:
+        order = &m_index.nameOrder();
+        range = {0, order->size()};
+        break;
+    default:
+        return false;
+    }
     
-    qDebug() << "Serializing" << count << "students";
+    total = quint64(range.second - range.first);
     
-    for (const Student& student : m_students) {
-        stream << student.id() 
-               << student.firstName() 
-               << student.middleName() 
-               << student.lastName() 
-               << student.birthDate();
+    const quint32 limit = query.limit == 0 ? kMaxQueryPage : qMin(query.limit, kMaxQueryPage);
+    const qsizetype first = range.first + qMin<qsizetype>(query.offset, range.second - range.first);
+    const qsizetype last = qMin<qsizetype>(range.second, first + limit);
+    
+    RosterWriter writer(RosterProtocol::SnapshotMessage, m_useStringTable);
+    writer.setSorted(order == &m_index.nameOrder());
+    for (qsizetype i = first; i < last; ++i) {
+        const quint32 key = order->at(i);
+        const StudentRow student = m_students.row(qsizetype(key) - 1);
+        addStudent(writer, key, student.id, student);
+    }
+    
+    body = writer.finish().value(0);
+    return true;
+}
+
+QList<RosterPartition> StudentManager::finishPartitions(QList<RosterWriter>& writers) const
+{
+    QList<RosterPartition> partitions;
+    partitions.reserve(writers.size());
+    
+    for (RosterWriter& writer : writers) {
+        RosterPartition chunks;
+        
+        // Раздел дельты без изменений остается пустым и не публикуется
+        if (writer.type() == RosterProtocol::SnapshotMessage || writer.count() > 0) {
+            for (const QByteArray& body : writer.finish()) {
+                quint8 flags = 0;
+                const QByteArray payload = m_useCompression ? RosterProtocol::compressBody(body, flags) : body;
+                chunks.append(RosterChunk{flags, payload});
+                RosterMetrics::add(RosterMetrics::SerializedBytes, quint64(payload.size()));
+            }
+            RosterMetrics::add(RosterMetrics::SerializedRecords, writer.count());
+        }
         
-        qDebug() << "  -" << student.id() << student.fullName() << student.birthDate().toString("dd.MM.yyyy");
+        partitions.append(chunks);
     }
     
-    qDebug() << "Serialized data size:" << data.size() << "bytes";
-    qDebug() << "First 100 bytes hex:" << data.left(100).toHex();
+    return partitions;
+}
+
+int StudentManager::fileIndex(const QString& filename)
+{
+    for (int i = 0; i < m_files.size(); ++i) {
+        if (m_files[i].filename == filename) {
+            return i;
+        }
+    }
     
-    return data;
+    m_files.append(SourceFile{filename, QHash<quint32, int>()});
+    return m_files.size() - 1;
 }
 
-void StudentManager::mergeDuplicates()
+void StudentManager::mergeDuplicates(int fileIndex, const StudentStore& incoming, QList<RosterChange>& changes)
 {
-    QList<Student> uniqueStudents;
-    QSet<QString> seenStudents;
+    RosterMetrics::ScopedTimer timer(RosterMetrics::DedupTime);
+    const quint64 version = m_version + 1;
+    quint64 hits = 0;
+    QHash<quint32, int> newIds;
+    newIds.reserve(incoming.size());
+    m_dedupIndex.reserve(m_liveCount + incoming.size());
+    
+    for (qsizetype i = 0; i < incoming.size(); ++i) {
+        const StudentRow student = incoming.row(i);
+        qsizetype row = m_dedupIndex.findOrInsert(
+            DedupIndex::fingerprint(student), m_students.size(),
+            [this, &student](qsizetype candidate) { return m_students.equals(candidate, student); });
+        
+        if (row < 0) {
+            row = m_students.append(student);
+            m_refCounts.append(0);
+            m_owners.append(fileIndex);
+        } else {
+            ++hits;
+            ROSTER_TRACE(lcDedup) << "Id" << student.id << "is a duplicate of key" << row + 1;
+        }
+        
+        const quint32 key = quint32(row + 1);
+        if (!newIds.contains(key)) {
+            newIds.insert(key, student.id);
+        }
+    }
+    
+    RosterMetrics::add(RosterMetrics::DedupLookups, quint64(incoming.size()));
+    RosterMetrics::add(RosterMetrics::DedupHits, hits);
+    
+    const QHash<quint32, int> oldIds = m_files[fileIndex].firstIds;
+    m_files[fileIndex].firstIds = newIds;
+    
+    for (auto it = newIds.cbegin(); it != newIds.cend(); ++it) {
+        const qsizetype row = qsizetype(it.key()) - 1;
+        
+        if (oldIds.contains(it.key())) {
+            updateOwnerId(row, changes);
+            continue;
+        }
+        
+        if (m_refCounts[row]++ == 0) {
+            ++m_liveCount;
+            m_owners[row] = fileIndex;
+            m_students.setId(row, it.value());
+            m_index.insert(it.key(), it.value());
+            changes.append(RosterChange{version, RosterProtocol::UpsertChange, it.key(), it.value()});
+            continue;
+        }
+        
+        // id берется из самого раннего файла, где встречается студент
+        if (fileIndex < m_owners[row]) {
+            m_owners[row] = fileIndex;
+        }
+        updateOwnerId(row, changes);
+    }
     
-    for (const Student& student : m_students) {
-        QString key = QString("%1|%2|%3|%4")
-            .arg(student.firstName())
-            .arg(student.middleName())
-            .arg(student.lastName())
-            .arg(student.birthDate().toString("yyyy-MM-dd")); // Унифицированный формат
+    for (auto it = oldIds.cbegin(); it != oldIds.cend(); ++it) {
+        if (newIds.contains(it.key())) {
+            continue;
+        }
+        
+        const qsizetype row = qsizetype(it.key()) - 1;
+        if (--m_refCounts[row] == 0) {
+            removeRow(row, changes);
+            continue;
+        }
         
-        if (!seenStudents.contains(key)) {
-            seenStudents.insert(key);
-            uniqueStudents.append(student);
+        if (m_owners[row] == fileIndex) {
+            int owner = fileIndex + 1;
+            while (owner < m_files.size() && !m_files[owner].firstIds.contains(it.key())) {
+                ++owner;
+            }
+            m_owners[row] = owner;
+            updateOwnerId(row, changes);
+        }
+    }
+}
+
+void StudentManager::updateOwnerId(qsizetype row, QList<RosterChange>& changes)
+{
+    const quint32 key = quint32(row + 1);
+    const int id = m_files.at(m_owners.at(row)).firstIds.value(key);
+    
+    if (m_students.id(row) != id) {
+        m_index.updateId(key, m_students.id(row), id);
+        m_students.setId(row, id);
+        changes.append(RosterChange{m_version + 1, RosterProtocol::UpsertChange, key, id});
+    }
+}
+
+void StudentManager::removeRow(qsizetype row, QList<RosterChange>& changes)
+{
+    m_dedupIndex.remove(DedupIndex::fingerprint(m_students.row(row)), row);
+    m_index.remove(quint32(row + 1), m_students.id(row));
+    --m_liveCount;
+    
+    changes.append(RosterChange{m_version + 1, RosterProtocol::RemoveChange, quint32(row + 1), m_students.id(row)});
+}
+
+void StudentManager::commitChanges(const QList<RosterChange>& changes)
+{
+    m_index.commit(m_students);
+    
+    if (changes.isEmpty()) {
+        return;
+    }
+    
+    m_version = changes.first().version;
+    
+    if (changes.size() > kMaxJournalSize) {
+        // Дельта больше снимка: отстающие клиенты дождутся полного снимка
+        m_journal.clear();
+        m_journalBaseVersion = m_version;
+    } else {
+        if (m_journal.size() + changes.size() > kMaxJournalSize) {
+            m_journal.clear();
+            m_journalBaseVersion = m_version - 1;
+        }
+        m_journal.append(changes);
+    }
+    
+    const qsizetype deadRows = m_students.size() - m_liveCount;
+    if (deadRows > kMinCompactRows && deadRows > m_liveCount) {
+        compact();
+    }
+}
+
+QList<QList<quint32>> StudentManager::findNearDuplicates(int edits) const
+{
+    RosterMetrics::ScopedTimer timer(RosterMetrics::NearDuplicateTime);
+    NearDuplicateFinder finder(edits);
+    finder.reserve(m_liveCount);
+    forEachStudent([&finder](quint32 key, const StudentRow& student) {
+        finder.add(key, student);
+    });
+    
+    const QList<QList<quint32>> clusters = finder.clusters();
+    qCDebug(lcDedup) << "Near-duplicate search made" << finder.comparisons() << "comparisons for"
+             << m_liveCount << "students";
+    return clusters;
+}
+
+QList<QStringList> StudentManager::describeNearDuplicates(int edits) const
+{
+    const QList<QList<quint32>> clusters = findNearDuplicates(edits);
+    
+    QList<QStringList> result;
+    result.reserve(clusters.size());
+    for (const QList<quint32>& cluster : clusters) {
+        QStringList names;
+        for (quint32 key : cluster) {
+            const Student student = m_students.toStudent(qsizetype(key) - 1);
+            names.append(QString("%1: %2 (%3)").arg(student.id()).arg(student.fullName())
+                         .arg(student.birthDate().toString("dd.MM.yyyy")));
         }
+        names.sort();
+        result.append(names);
     }
     
-    m_students = uniqueStudents;
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void StudentManager::compact()
+{
+    QList<qsizetype> newRows(m_students.size(), -1);
+    StudentStore students;
+    QList<int> refCounts;
+    QList<int> owners;
+    students.reserve(m_liveCount);
+    refCounts.reserve(m_liveCount);
+    owners.reserve(m_liveCount);
+    
+    for (qsizetype row = 0; row < m_students.size(); ++row) {
+        if (m_refCounts.at(row) > 0) {
+            // Буфер строк собирается заново, имена удаленных строк в него не попадают
+            newRows[row] = students.append(m_students.row(row));
+            refCounts.append(m_refCounts.at(row));
+            owners.append(m_owners.at(row));
+        }
+    }
+    
+    m_dedupIndex.remapRows(newRows);
+    
+    for (SourceFile& file : m_files) {
+        QHash<quint32, int> ids;
+        ids.reserve(file.firstIds.size());
+        for (auto it = file.firstIds.cbegin(); it != file.firstIds.cend(); ++it) {
+            ids.insert(quint32(newRows.at(qsizetype(it.key()) - 1) + 1), it.value());
+        }
+        file.firstIds.swap(ids);
+    }
+    
+    m_students = std::move(students);
+    m_refCounts.swap(refCounts);
+    m_owners.swap(owners);
+    m_index.rebuild(m_students);
+    
+    // Ключи строк изменились, поэтому дельты от прежних версий невозможны
+    ++m_version;
+    m_journal.clear();
+    m_journalBaseVersion = m_version;
+    
+    qCInfo(lcDedup) << "Compacted roster to" << m_liveCount << "rows," << m_students.byteSize() << "bytes, version" << m_version;
 }
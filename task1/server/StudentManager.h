@@ -1,9 +1,26 @@
 #ifndef STUDENTMANAGER_H
 #define STUDENTMANAGER_H
 
+#include <QHash>
 #include <QList>
-#include <QSet>
+#include <QStringList>
+#include "DedupIndex.h"
+#include "RosterCodec.h"
+#include "RosterProtocol.h"
+#include "RosterSnapshot.h"
 #include "Student.h"
+#include "StudentIndex.h"
+#include "StudentStore.h"
+
+// Имена строки не меняются, пока она существует, поэтому изменение хранит
+// только id; остальное берется из строки хранилища при кодировании дельты
+struct RosterChange
+{
+    quint64 version;
+    RosterProtocol::ChangeType type;
+    quint32 key;
+    qint32 id;
+};
 
 class StudentManager
 {
@@ -11,13 +28,101 @@ public:
     StudentManager();
     
     void loadStudentsFromFiles(const QStringList& filenames);
+    void appendStudentsFromFiles(const QStringList& filenames);
+    void reloadFile(const QString& filename, const StudentStore& students);
+    QStringList filenames() const;
+    
     QList<Student> getUniqueStudents() const;
-    QByteArray serializeStudents() const;
+    qsizetype count() const { return m_liveCount; }
+    
+    // Строки хранилища без копирования; удаленные строки пропускаются
+    template<typename Function>
+    void forEachStudent(Function function) const;
+    QList<RosterPartition> serializeStudents() const;
+    QList<RosterPartition> serializeChanges(const QList<RosterChange>& changes) const;
+    
+    // Тело ответа на запрос: страница подходящих студентов в порядке индекса;
+    // total - сколько студентов подходит всего. false - неизвестный запрос
+    bool serializeQuery(const RosterProtocol::Query& query, QByteArray& body, quint64& total) const;
+    const StudentIndex& index() const { return m_index; }
+    
+    void setStringTableEnabled(bool enabled) { m_useStringTable = enabled; }
+    bool isStringTableEnabled() const { return m_useStringTable; }
+    
+    void setCompressionEnabled(bool enabled) { m_useCompression = enabled; }
+    bool isCompressionEnabled() const { return m_useCompression; }
+    
+    // Снимок кодируется в порядке ФИО из индекса, клиенты не сортируют его сами
+    void setPresortEnabled(bool enabled) { m_presort = enabled; }
+    bool isPresortEnabled() const { return m_presort; }
+    
+    // Группы ключей живых строк, похожих с точностью до edits правок;
+    // точные дубликаты уже объединены и сюда не попадают
+    QList<QList<quint32>> findNearDuplicates(int edits) const;
     
+    // Те же группы как строки "id: ФИО (дата)". Строки группы и сами группы
+    // упорядочены и не зависят от ключей, поэтому одна и та же группа разных
+    // версий списка описывается одинаково
+    QList<QStringList> describeNearDuplicates(int edits) const;
+    
+    // Предел размера одного тела. Снимок кодируется и хранится целиком,
+    // ограничен только размер кадра на проводе
+    void setChunkSize(qsizetype bytes) { m_chunkSize = bytes; }
+    qsizetype chunkSize() const { return m_chunkSize; }
+    
+    void setPartitionCount(quint32 count) { m_partitionCount = qBound(1u, count, RosterProtocol::MaxPartitions); }
+    quint32 partitionCount() const { return m_partitionCount; }
+    
+    quint64 version() const { return m_version; }
+    bool changesSince(quint64 version, QList<RosterChange>& changes) const;
+
 private:
-    QList<Student> m_students;
+    // Вклад одного файла: ключ строки -> id первой записи файла с этим студентом
+    struct SourceFile
+    {
+        QString filename;
+        QHash<quint32, int> firstIds;
+    };
+    
+    // Строки не перемещаются, ключ строки равен ее номеру + 1.
+    // Удаленные строки (m_refCounts == 0) сохраняют имена до уплотнения:
+    // по ним кодируются еще не опубликованные изменения из журнала.
+    StudentStore m_students;
+    QList<int> m_refCounts;
+    QList<int> m_owners;
+    qsizetype m_liveCount;
+    DedupIndex m_dedupIndex;
+    StudentIndex m_index;
+    QList<SourceFile> m_files;
+    bool m_useStringTable;
+    bool m_useCompression;
+    bool m_presort;
+    qsizetype m_chunkSize;
+    quint32 m_partitionCount;
     
-    void mergeDuplicates();
+    quint64 m_version;
+    
+    // Журнал изменений для дельт; хранит изменения после m_journalBaseVersion
+    QList<RosterChange> m_journal;
+    quint64 m_journalBaseVersion;
+    
+    int fileIndex(const QString& filename);
+    void mergeDuplicates(int fileIndex, const StudentStore& incoming, QList<RosterChange>& changes);
+    void updateOwnerId(qsizetype row, QList<RosterChange>& changes);
+    void removeRow(qsizetype row, QList<RosterChange>& changes);
+    void commitChanges(const QList<RosterChange>& changes);
+    void compact();
+    QList<RosterPartition> finishPartitions(QList<RosterWriter>& writers) const;
 };
 
+template<typename Function>
+void StudentManager::forEachStudent(Function function) const
+{
+    for (qsizetype row = 0; row < m_students.size(); ++row) {
+        if (m_refCounts.at(row) > 0) {
+            function(quint32(row + 1), m_students.row(row));
+        }
+    }
+}
+
 #endif // STUDENTMANAGER_H
@@ -1,126 +1,310 @@
 #include "StudentParser.h"
+#include "DateDecoder.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
 #include <QFile>
-#include <QTextStream>
 #include <QDebug>
 #include <QRegularExpression>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
-StudentParser::StudentParser()
+namespace {
+
+bool isBlank(char c)
 {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
 }
 
-QList<Student> StudentParser::parseFile(const QString& filename)
+QByteArrayView trimmedView(QByteArrayView text)
 {
-    QList<Student> students;
+    const char* begin = text.data();
+    const char* end = begin + text.size();
     
-    QFile file(filename);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Cannot open file:" << filename;
-        return students;
+    while (begin < end && isBlank(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isBlank(end[-1])) {
+        --end;
     }
     
-    QTextStream in(&file);
-    int lineNumber = 0;
+    return QByteArrayView(begin, end - begin);
+}
+
+bool parseInt(QByteArrayView text, int& value)
+{
+    qsizetype i = 0;
+    bool negative = false;
     
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        lineNumber++;
-        
-        if (line.isEmpty() || line.startsWith("--")) {
-            continue;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-')) {
+        negative = text[i] == '-';
+        ++i;
+    }
+    if (i == text.size()) {
+        return false;
+    }
+    
+    const qint64 limit = qint64(std::numeric_limits<int>::max()) + (negative ? 1 : 0);
+    qint64 result = 0;
+    
+    for (; i < text.size(); ++i) {
+        const unsigned digit = static_cast<unsigned char>(text[i]) - unsigned('0');
+        if (digit > 9) {
+            return false;
+        }
+        result = result * 10 + digit;
+        if (result > limit) {
+            return false;
         }
-        
-        QList<Student> lineStudents = parseLineSimple(line, lineNumber);
-        students.append(lineStudents);
     }
     
-    file.close();
-    return students;
+    value = static_cast<int>(negative ? -result : result);
+    return true;
 }
 
-QList<Student> StudentParser::parseLineSimple(const QString& line, int lineNumber)
+// Длина в символах QString (UTF-16), как у прежнего QString::length()
+qsizetype utf16Length(QByteArrayView text)
 {
-    QList<Student> students;
-    
-    QStringList parts = line.split(" ", Qt::SkipEmptyParts);
-    
-    qDebug() << "Parsing line:" << line;
-    qDebug() << "Parts count:" << parts.size();
+    qsizetype length = 0;
+    for (char c : text) {
+        const unsigned char byte = static_cast<unsigned char>(c);
+        if ((byte & 0xC0) != 0x80) {
+            length += byte >= 0xF0 ? 2 : 1;
+        }
+    }
+    return length;
+}
+
+bool looksLikeDate(QByteArrayView text)
+{
+    return memchr(text.data(), '.', text.size()) != nullptr || utf16Length(text) == 10;
+}
+
+} // namespace
+
+StudentParser::StudentParser()
+    : m_chunkSize(4 * 1024 * 1024)
+{
+}
+
+StudentStore StudentParser::parseFile(const QString& filename)
+{
+    return parseFiles(QStringList{filename}).value(0);
+}
+
+QList<StudentStore> StudentParser::parseFiles(const QStringList& filenames)
+{
+    RosterMetrics::ScopedTimer timer(RosterMetrics::ParseTime);
+    QList<StudentStore> result(filenames.size());
+    QList<QFile*> files;
+    QList<QByteArray> buffers;
+    QList<Chunk> chunks;
     
-    if (parts.size() >= 4) {
-        bool idOk = false;
-        int id = parts[0].toInt(&idOk);
+    for (int i = 0; i < filenames.size(); ++i) {
+        QFile* file = new QFile(filenames[i]);
+        files.append(file);
+        
+        if (!file->open(QIODevice::ReadOnly)) {
+            qCWarning(lcParser) << "Cannot open file:" << filenames[i];
+            continue;
+        }
         
-        if (!idOk) {
-            qWarning() << "Invalid ID at line" << lineNumber << ":" << parts[0];
-            return students;
+        qsizetype size = file->size();
+        if (size == 0) {
+            continue;
         }
         
-        QString firstName, middleName, lastName;
-        QString dateStr;
+        const char* data = reinterpret_cast<const char*>(file->map(0, size));
+        if (!data) {
+            // Файл не отображается в память (pipe, спецфайл) - читаем целиком
+            buffers.append(file->readAll());
+            data = buffers.last().constData();
+            size = buffers.last().size();
+        }
         
-        if (parts.size() == 4) {
-            lastName = parts[1];
-            firstName = parts[2];
-            dateStr = parts[3];
-        } else if (parts.size() >= 5) {
-            lastName = parts[1];
-            firstName = parts[2];
-            
-            if (parts[3].contains('.') || parts[3].length() == 10) {
-                dateStr = parts[3];
-            } else {
-                middleName = parts[3];
-                dateStr = parts[4];
-            }
+        // UTF-8 BOM, который раньше пропускал QTextStream
+        if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            data += 3;
+            size -= 3;
+        }
+        
+        splitIntoChunks(i, data, size, chunks);
+    }
+    
+    // Блоки всех файлов разбираются параллельно, порядок результатов сохраняется
+    const QList<StudentStore> parsed = QtConcurrent::blockingMapped<QList<StudentStore>>(
+        chunks, [this](const Chunk& chunk) { return parseChunk(chunk); });
+    
+    // Имена копируются из отображенного файла в буфер строк, поэтому файл можно закрыть
+    for (qsizetype i = 0; i < chunks.size(); ++i) {
+        result[chunks[i].fileIndex].append(parsed[i]);
+    }
+    
+    qDeleteAll(files);
+    return result;
+}
+
+void StudentParser::splitIntoChunks(int fileIndex, const char* data, qsizetype size, QList<Chunk>& chunks) const
+{
+    int lineNumber = 1;
+    qsizetype offset = 0;
+    
+    while (offset < size) {
+        qsizetype end = qMin(offset + m_chunkSize, size);
+        if (end < size) {
+            const void* newline = memchr(data + end, '\n', size - end);
+            end = newline ? static_cast<const char*>(newline) - data + 1 : size;
         }
         
-        bool dateOk = false;
-        QDate birthDate = parseDate(dateStr, dateOk);
+        chunks.append(Chunk{fileIndex, data + offset, end - offset, lineNumber});
+        lineNumber += static_cast<int>(std::count(data + offset, data + end, '\n'));
+        offset = end;
+    }
+}
+
+StudentStore StudentParser::parseChunk(const Chunk& chunk)
+{
+    QList<Record> records;
+    QList<QByteArrayView> dates;
+    
+    const char* cursor = chunk.data;
+    const char* end = chunk.data + chunk.size;
+    int lineNumber = chunk.firstLineNumber;
+    qsizetype candidates = 0;
+    
+    while (cursor < end) {
+        const char* newline = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+        const char* lineEnd = newline ? newline : end;
         
-        if (dateOk) {
-            Student student(id, firstName, middleName, lastName, birthDate);
-            if (validateStudent(student)) {
-                students.append(student);
-                qDebug() << "Successfully parsed:" << student.fullName();
-            } else {
-                qWarning() << "Invalid student data at line" << lineNumber;
+        QByteArrayView line = trimmedView(QByteArrayView(cursor, lineEnd - cursor));
+        if (!line.isEmpty() && !line.startsWith("--")) {
+            ++candidates;
+            Record record;
+            if (tokenizeLine(line, lineNumber, record)) {
+                records.append(record);
+                dates.append(record.date);
             }
-        } else {
-            qWarning() << "Invalid date at line" << lineNumber << ":" << dateStr;
         }
-    } else {
-        qWarning() << "Not enough parts at line" << lineNumber << ":" << line;
+        
+        ++lineNumber;
+        cursor = newline ? newline + 1 : end;
     }
     
+    // Даты всего блока декодируются одним проходом по колонке
+    QList<qint64> days(dates.size());
+    DateDecoder::decodeColumn(dates.constData(), dates.size(), days.data());
+    
+    StudentStore students;
+    students.reserve(records.size());
+    for (qsizetype i = 0; i < records.size(); ++i) {
+        buildStudent(records[i], days[i], students);
+    }
+    
+    // Счетчики обновляются раз на блок, а не на запись
+    RosterMetrics::add(RosterMetrics::ParsedBytes, quint64(chunk.size));
+    RosterMetrics::add(RosterMetrics::ParsedRecords, quint64(students.size()));
+    RosterMetrics::add(RosterMetrics::ParseErrors, quint64(candidates - students.size()));
+    
     return students;
 }
 
-QList<Student> StudentParser::parseLine(const QString& line, int lineNumber)
+QList<Student> StudentParser::parseLineSimple(const QString& line, int lineNumber)
 {
-    return parseLineSimple(line, lineNumber);
+    StudentStore store;
+    const QByteArray utf8 = line.toUtf8();
+    
+    Record record;
+    if (tokenizeLine(trimmedView(utf8), lineNumber, record)) {
+        buildStudent(record, DateDecoder::decode(record.date), store);
+    }
+    
+    QList<Student> students;
+    for (qsizetype i = 0; i < store.size(); ++i) {
+        students.append(store.toStudent(i));
+    }
+    return students;
 }
 
-QDate StudentParser::parseDate(const QString& dateStr, bool& ok)
+bool StudentParser::tokenizeLine(QByteArrayView line, int lineNumber, Record& record)
 {
-    QStringList dateParts = dateStr.split(".");
+    // Поля ищутся прямо в буфере строки, строки копируются только для валидной записи
+    QByteArrayView parts[5];
+    qsizetype partCount = 0;
     
-    if (dateParts.size() == 3) {
-        int day = dateParts[0].toInt();
-        int month = dateParts[1].toInt();
-        int year = dateParts[2].toInt();
+    const char* cursor = line.data();
+    const char* end = cursor + line.size();
+    
+    while (cursor < end) {
+        if (*cursor == ' ') {
+            ++cursor;
+            continue;
+        }
         
-        QDate date(year, month, day);
-        if (date.isValid()) {
-            ok = true;
-            return date;
+        const char* tokenEnd = static_cast<const char*>(memchr(cursor, ' ', end - cursor));
+        if (!tokenEnd) {
+            tokenEnd = end;
         }
+        
+        if (partCount < 5) {
+            parts[partCount] = QByteArrayView(cursor, tokenEnd - cursor);
+        }
+        ++partCount;
+        cursor = tokenEnd;
+    }
+    
+    if (partCount < 4) {
+        qCWarning(lcParser) << "Not enough parts at line" << lineNumber << ":" << QString::fromUtf8(line);
+        return false;
+    }
+    
+    if (!parseInt(parts[0], record.id)) {
+        qCWarning(lcParser) << "Invalid ID at line" << lineNumber << ":" << QString::fromUtf8(parts[0]);
+        return false;
+    }
+    
+    record.lineNumber = lineNumber;
+    record.lastName = parts[1];
+    record.firstName = parts[2];
+    record.middleName = QByteArrayView();
+    record.date = parts[3];
+    
+    if (partCount >= 5 && !looksLikeDate(parts[3])) {
+        record.middleName = parts[3];
+        record.date = parts[4];
     }
     
-    ok = false;
-    return QDate();
+    return true;
+}
+
+void StudentParser::buildStudent(const Record& record, qint64 julianDay, StudentStore& students)
+{
+    if (julianDay == DateDecoder::InvalidDay) {
+        qCWarning(lcParser) << "Invalid date at line" << record.lineNumber << ":" << QString::fromUtf8(record.date);
+        return;
+    }
+    
+    // Имена остаются представлениями буфера файла до копирования в хранилище
+    const StudentRow student{record.id, record.firstName, record.middleName, record.lastName, qint32(julianDay)};
+    if (validateStudent(student)) {
+        ROSTER_TRACE(lcParser) << "Line" << record.lineNumber << "id" << student.id << QString::fromUtf8(student.lastName)
+                               << QString::fromUtf8(student.firstName) << "day" << student.julianDay;
+        students.append(student);
+    } else {
+        qCWarning(lcParser) << "Invalid student data at line" << record.lineNumber;
+    }
+}
+
+QList<Student> StudentParser::parseLine(const QString& line, int lineNumber)
+{
+    return parseLineSimple(line, lineNumber);
 }
 
-bool StudentParser::validateStudent(const Student& student)
+bool StudentParser::validateStudent(const StudentRow& student)
 {
-    return student.isValid();
+    // Те же правила, что в Student::isValid
+    return student.id > 0 &&
+           !student.firstName.isEmpty() &&
+           !student.lastName.isEmpty() &&
+           QDate::fromJulianDay(student.julianDay).isValid();
 }
@@ -1,23 +1,53 @@
 #ifndef STUDENTPARSER_H
 #define STUDENTPARSER_H
 
+#include <QByteArrayView>
 #include <QList>
 #include <QString>
+#include <QStringList>
 #include "Student.h"
+#include "StudentStore.h"
 
 class StudentParser
 {
 public:
     StudentParser();
     
-    QList<Student> parseFile(const QString& filename);
+    StudentStore parseFile(const QString& filename);
+    QList<StudentStore> parseFiles(const QStringList& filenames);
     QList<Student> parseLine(const QString& line, int lineNumber);
     
+    void setChunkSize(qsizetype chunkSize) { m_chunkSize = chunkSize; }
+    qsizetype chunkSize() const { return m_chunkSize; }
+    
 private:
-    QDate parseDate(const QString& dateStr, bool& ok);
-    bool validateStudent(const Student& student);
+    struct Chunk
+    {
+        int fileIndex;
+        const char* data;
+        qsizetype size;
+        int firstLineNumber;
+    };
+    
+    struct Record
+    {
+        int lineNumber = 0;
+        int id = 0;
+        QByteArrayView firstName;
+        QByteArrayView middleName;
+        QByteArrayView lastName;
+        QByteArrayView date;
+    };
+    
+    bool validateStudent(const StudentRow& student);
     
     QList<Student> parseLineSimple(const QString& line, int lineNumber);
+    bool tokenizeLine(QByteArrayView line, int lineNumber, Record& record);
+    void buildStudent(const Record& record, qint64 julianDay, StudentStore& students);
+    StudentStore parseChunk(const Chunk& chunk);
+    void splitIntoChunks(int fileIndex, const char* data, qsizetype size, QList<Chunk>& chunks) const;
+    
+    qsizetype m_chunkSize;
 };
 
 #endif // STUDENTPARSER_H
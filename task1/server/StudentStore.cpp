@@ -0,0 +1,92 @@
+#include "StudentStore.h"
+
+StringArena::StringArena()
+    : m_offsets({0})
+{
+}
+
+quint32 StringArena::intern(QByteArrayView text)
+{
+    const quint32 id = quint32(count());
+    const qsizetype existing = m_index.findOrInsert(
+        DedupIndex::hashBytes(text), id,
+        [this, text](qsizetype candidate) { return view(quint32(candidate)) == text; });
+    
+    if (existing >= 0) {
+        return quint32(existing);
+    }
+    
+    m_data.append(text.data(), text.size());
+    m_offsets.append(quint32(m_data.size()));
+    return id;
+}
+
+void StringArena::clear()
+{
+    m_data.clear();
+    m_offsets = {0};
+    m_index.clear();
+}
+
+bool StudentStore::equals(qsizetype index, const StudentRow& row) const
+{
+    return m_days.at(index) == row.julianDay &&
+           m_names.view(m_lastNames.at(index)) == row.lastName &&
+           m_names.view(m_firstNames.at(index)) == row.firstName &&
+           m_names.view(m_middleNames.at(index)) == row.middleName;
+}
+
+qsizetype StudentStore::append(const StudentRow& row)
+{
+    m_ids.append(row.id);
+    m_firstNames.append(m_names.intern(row.firstName));
+    m_middleNames.append(m_names.intern(row.middleName));
+    m_lastNames.append(m_names.intern(row.lastName));
+    m_days.append(row.julianDay);
+    return m_ids.size() - 1;
+}
+
+void StudentStore::append(const StudentStore& other)
+{
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+    
+    reserve(size() + other.size());
+    for (qsizetype i = 0; i < other.size(); ++i) {
+        append(other.row(i));
+    }
+}
+
+void StudentStore::reserve(qsizetype count)
+{
+    m_ids.reserve(count);
+    m_firstNames.reserve(count);
+    m_middleNames.reserve(count);
+    m_lastNames.reserve(count);
+    m_days.reserve(count);
+}
+
+void StudentStore::clear()
+{
+    m_ids.clear();
+    m_firstNames.clear();
+    m_middleNames.clear();
+    m_lastNames.clear();
+    m_days.clear();
+    m_names.clear();
+}
+
+Student StudentStore::toStudent(qsizetype index) const
+{
+    const StudentRow student = row(index);
+    return Student(student.id, QString::fromUtf8(student.firstName), QString::fromUtf8(student.middleName),
+                   QString::fromUtf8(student.lastName), QDate::fromJulianDay(student.julianDay));
+}
+
+qsizetype StudentStore::byteSize() const
+{
+    return size() * qsizetype(sizeof(qint32) * 2 + sizeof(quint32) * 3) +
+           m_names.count() * qsizetype(sizeof(quint32)) + m_names.byteSize();
+}
@@ -0,0 +1,83 @@
+#ifndef STUDENTSTORE_H
+#define STUDENTSTORE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include "DedupIndex.h"
+#include "Student.h"
+
+// Представление строки хранилища. Имена - UTF-8 прямо в буфере строк
+// хранилища (или разбираемого файла) и действительны, пока он не изменен.
+struct StudentRow
+{
+    qint32 id = 0;
+    QByteArrayView firstName;
+    QByteArrayView middleName;
+    QByteArrayView lastName;
+    qint32 julianDay = 0;
+};
+
+// Интернированные строки: каждое различное значение хранится в общем буфере один раз
+class StringArena
+{
+public:
+    StringArena();
+    
+    quint32 intern(QByteArrayView text);
+    QByteArrayView view(quint32 id) const
+    {
+        return QByteArrayView(m_data.constData() + m_offsets.at(id), m_offsets.at(id + 1) - m_offsets.at(id));
+    }
+    
+    qsizetype count() const { return m_offsets.size() - 1; }
+    qsizetype byteSize() const { return m_data.size(); }
+    void clear();
+    
+private:
+    QByteArray m_data;
+    QList<quint32> m_offsets;
+    DedupIndex m_index;
+};
+
+// Список студентов по колонкам: id, номера имен в общем буфере строк и юлианский день.
+// Строка занимает 20 байт плюс новые имена, вместо четырех QString и QDate.
+class StudentStore
+{
+public:
+    qsizetype size() const { return m_ids.size(); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+    
+    StudentRow row(qsizetype index) const
+    {
+        return StudentRow{m_ids.at(index), m_names.view(m_firstNames.at(index)),
+                          m_names.view(m_middleNames.at(index)), m_names.view(m_lastNames.at(index)),
+                          m_days.at(index)};
+    }
+    
+    qint32 id(qsizetype index) const { return m_ids.at(index); }
+    void setId(qsizetype index, qint32 id) { m_ids[index] = id; }
+    
+    // Совпадение ФИО и даты рождения (id не учитывается)
+    bool equals(qsizetype index, const StudentRow& row) const;
+    
+    qsizetype append(const StudentRow& row);
+    void append(const StudentStore& other);
+    void reserve(qsizetype count);
+    void clear();
+    
+    Student toStudent(qsizetype index) const;
+    
+    // Приблизительный объем колонок и буфера строк
+    qsizetype byteSize() const;
+    
+private:
+    QList<qint32> m_ids;
+    QList<quint32> m_firstNames;
+    QList<quint32> m_middleNames;
+    QList<quint32> m_lastNames;
+    QList<qint32> m_days;
+    StringArena m_names;
+};
+
+#endif // STUDENTSTORE_H
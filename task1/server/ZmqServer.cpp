@@ -1,98 +1,371 @@
 #include "ZmqServer.h"
+#include "RosterLogging.h"
+#include "RosterMetrics.h"
+#include "StudentParser.h"
 #include <QDebug>
 #include <QThread>
 #include <QCoreApplication>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+// Дельты старше этого числа изменений не хранятся: отставший поток публикации отправит снимок
+const qsizetype kMaxDeltaChain = 64;
+
+// Поиск почти дубликатов запускается, когда изменения стихли на это время
+const int kNearDuplicateDelayMs = 1000;
+
+// Новые группы почти дубликатов сверх этого числа попадут в следующий отчет
+const qsizetype kMaxReportedClusters = 100;
+
+} // namespace
 
 ZmqServer::ZmqServer(const QString& endpoint, QObject *parent)
     : QObject(parent)
-    , m_endpoint(endpoint)
+    , m_endpoints({endpoint})
     , m_context(nullptr)
-    , m_socket(nullptr)
+    , m_ownsContext(true)
     , m_studentManager(new StudentManager())
     , m_workerThread(new QThread(this))
+    , m_publisher(new RosterPublisher())
     , m_running(false)
+    , m_querySocket(nullptr)
+    , m_queryNotifier(nullptr)
+    , m_inputFiles({"student_file_1.txt", "student_file_2.txt"})
+    , m_fileWatcher(new QFileSystemWatcher(this))
+    , m_reloadTimer(new QTimer(this))
+    , m_reloadInProgress(false)
+    , m_nearDuplicateEdits(0)
+    , m_nearDuplicateTimer(new QTimer(this))
+    , m_nearDuplicateRunning(false)
 {
+    // Редакторы сохраняют файл в несколько приемов, поэтому перечитываем с задержкой
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(200);
+    connect(m_reloadTimer, &QTimer::timeout, this, &ZmqServer::reloadChangedFiles);
+    
+    connect(m_fileWatcher, &QFileSystemWatcher::fileChanged, this, &ZmqServer::onInputFileChanged);
+    
+    m_nearDuplicateTimer->setSingleShot(true);
+    m_nearDuplicateTimer->setInterval(kNearDuplicateDelayMs);
+    connect(m_nearDuplicateTimer, &QTimer::timeout, this, &ZmqServer::findNearDuplicates);
+    
+    // Издатель живет в рабочем потоке, сигнал доставляется ему через очередь
+    m_publisher->moveToThread(m_workerThread);
+    connect(this, &ZmqServer::rosterChanged, m_publisher, &RosterPublisher::rosterChanged);
+    connect(m_publisher, &RosterPublisher::snapshotRequested, this, &ZmqServer::captureSnapshotSource);
 }
 
 ZmqServer::~ZmqServer()
 {
     stop();
+    delete m_publisher;
+    delete m_studentManager;
 }
 
 void ZmqServer::start()
 {
-    try {
+    if (!m_context) {
         m_context = new zmq::context_t(1);
-        m_socket = new zmq::socket_t(*m_context, ZMQ_PUB);
-        m_socket->bind(m_endpoint.toStdString());
-        
-        QStringList files = {"student_file_1.txt", "student_file_2.txt"};
-        m_studentManager->loadStudentsFromFiles(files);
-        
-        m_running = true;
-        
-        m_workerThread->start();
-        QMetaObject::invokeMethod(this, &ZmqServer::sendStudents, Qt::QueuedConnection);
-        
-        qDebug() << "ZMQ Server started on" << m_endpoint;
+        m_ownsContext = true;
+    }
+    
+    m_studentManager->loadStudentsFromFiles(m_inputFiles);
+    m_fileWatcher->addPaths(m_inputFiles);
+    handOffRoster();
+    
+    m_publisher->setContext(m_context);
+    m_publisher->setEndpoints(m_endpoints);
+    m_workerThread->start();
+    
+    bool started = false;
+    QMetaObject::invokeMethod(m_publisher, &RosterPublisher::start, Qt::BlockingQueuedConnection, &started);
+    if (!started) {
+        m_workerThread->quit();
+        m_workerThread->wait();
+        return;
+    }
+    
+    if (!startQueries()) {
+        stop();
+        return;
+    }
+    
+    m_running = true;
+    qCInfo(lcTransport) << "ZMQ Server started on" << m_endpoints;
+}
+
+bool ZmqServer::startQueries()
+{
+    if (m_queryEndpoints.isEmpty()) {
+        return true;
+    }
+    
+    try {
+        m_querySocket = new zmq::socket_t(*m_context, ZMQ_ROUTER);
+        for (const QString& endpoint : std::as_const(m_queryEndpoints)) {
+            m_querySocket->bind(endpoint.toStdString());
+        }
         
+        m_queryNotifier = new QSocketNotifier(qintptr(m_querySocket->get(zmq::sockopt::fd)),
+                                              QSocketNotifier::Read, this);
+        connect(m_queryNotifier, &QSocketNotifier::activated, this, &ZmqServer::serveQueries);
     } catch (const zmq::error_t& e) {
-        qCritical() << "ZMQ error:" << e.what();
+        qCCritical(lcTransport) << "ZMQ query socket error:" << e.what();
+        return false;
     }
+    
+    // Запросы могли прийти до создания уведомителя
+    QMetaObject::invokeMethod(this, &ZmqServer::serveQueries, Qt::QueuedConnection);
+    
+    qCInfo(lcTransport) << "Serving queries on" << m_queryEndpoints;
+    return true;
 }
 
 void ZmqServer::stop()
 {
     m_running = false;
+    m_reloadTimer->stop();
+    m_nearDuplicateTimer->stop();
     
-    if (m_workerThread && m_workerThread->isRunning()) {
+    if (m_workerThread->isRunning()) {
+        // Сокет закрывается в потоке, которому он принадлежит
+        QMetaObject::invokeMethod(m_publisher, &RosterPublisher::stop, Qt::BlockingQueuedConnection);
         m_workerThread->quit();
-        m_workerThread->wait(1000);
+        m_workerThread->wait();
     }
     
-    if (m_socket) {
-        m_socket->close();
-        delete m_socket;
-        m_socket = nullptr;
+    delete m_queryNotifier;
+    m_queryNotifier = nullptr;
+    
+    if (m_querySocket) {
+        m_querySocket->close();
+        delete m_querySocket;
+        m_querySocket = nullptr;
     }
     
-    if (m_context) {
+    if (m_context && m_ownsContext) {
         m_context->close();
         delete m_context;
-        m_context = nullptr;
     }
+    m_context = nullptr;
 }
 
-void ZmqServer::sendStudents()
+quint64 ZmqServer::updateFile(const QString& filename, const StudentStore& students)
 {
-    while (m_running) {
-        try {
-            QByteArray data = m_studentManager->serializeStudents();
-            
-            if (!data.isEmpty()) {
-                zmq::message_t message(data.size());
-                memcpy(message.data(), data.constData(), data.size());
-                
-                auto result = m_socket->send(message, zmq::send_flags::dontwait);
-                
-                if (result.has_value() && result.value() > 0) {
-                    qDebug() << "Sent" << data.size() << "bytes with student data";
-                } else {
-                    qDebug() << "No subscribers connected";
+    m_studentManager->reloadFile(filename, students);
+    handOffRoster();
+    return m_studentManager->version();
+}
+
+void ZmqServer::handOffRoster()
+{
+    const quint64 version = m_studentManager->version();
+    if (m_handedOff && m_handedOff->version == version) {
+        return;
+    }
+    
+    // Здесь кодируется только дельта; снимок поток публикации кодирует сам,
+    // когда он нужен, по копии списка (см. captureSnapshotSource)
+    auto state = std::make_shared<RosterState>();
+    state->version = version;
+    
+    QList<RosterChange> changes;
+    if (m_handedOff && m_studentManager->changesSince(m_handedOff->version, changes)) {
+        state->deltas = m_handedOff->deltas;
+        state->deltas.append(std::make_shared<const RosterDelta>(
+            RosterDelta{m_handedOff->version, version, m_studentManager->serializeChanges(changes)}));
+        if (state->deltas.size() > kMaxDeltaChain) {
+            state->deltas.remove(0, state->deltas.size() - kMaxDeltaChain);
+        }
+    }
+    
+    m_handedOff = state;
+    m_publisher->setState(m_handedOff);
+    emit rosterChanged();
+    
+    if (m_nearDuplicateEdits > 0) {
+        m_nearDuplicateTimer->start();
+    }
+}
+
+void ZmqServer::captureSnapshotSource()
+{
+    handOffRoster();
+    if (!m_handedOff) {
+        return;
+    }
+    
+    // Копия дешевая: данные разделяются, пока основной поток их не изменит
+    auto state = std::make_shared<RosterState>(*m_handedOff);
+    state->source = std::make_shared<const StudentManager>(*m_studentManager);
+    m_publisher->setState(state);
+    emit rosterChanged();
+}
+
+void ZmqServer::findNearDuplicates()
+{
+    if (m_nearDuplicateRunning) {
+        // Изменения будут учтены после завершения текущего поиска
+        return;
+    }
+    m_nearDuplicateRunning = true;
+    
+    // Копия дешевая и не меняется, пока основной поток вносит новые изменения
+    const auto source = std::make_shared<const StudentManager>(*m_studentManager);
+    const quint64 version = source->version();
+    const int edits = m_nearDuplicateEdits;
+    
+    auto* watcher = new QFutureWatcher<QList<QStringList>>(this);
+    connect(watcher, &QFutureWatcher<QList<QStringList>>::finished, this, [this, watcher, version]() {
+        reportNearDuplicates(watcher->result());
+        watcher->deleteLater();
+        m_nearDuplicateRunning = false;
+        
+        if (version != m_studentManager->version() && !m_nearDuplicateTimer->isActive()) {
+            m_nearDuplicateTimer->start();
+        }
+    });
+    
+    watcher->setFuture(QtConcurrent::run([source, edits]() {
+        return source->describeNearDuplicates(edits);
+    }));
+}
+
+void ZmqServer::reportNearDuplicates(const QList<QStringList>& clusters)
+{
+    // Группа, которая пропала из списка и появилась снова, считается новой
+    QSet<QString> reported;
+    qsizetype students = 0;
+    qsizetype added = 0;
+    
+    for (const QStringList& cluster : clusters) {
+        students += cluster.size();
+        const QString text = cluster.join("; ");
+        if (m_reportedClusters.contains(text)) {
+            reported.insert(text);
+        } else if (added < kMaxReportedClusters) {
+            qCInfo(lcDedup).noquote() << "Possible duplicates:" << text;
+            reported.insert(text);
+            ++added;
+        }
+    }
+    
+    m_reportedClusters.swap(reported);
+    qCInfo(lcDedup) << "Near duplicates within" << m_nearDuplicateEdits << "edits:" << clusters.size()
+            << "groups," << students << "students," << added << "new";
+}
+
+void ZmqServer::onInputFileChanged(const QString& path)
+{
+    m_changedFiles.insert(path);
+    m_reloadTimer->start();
+}
+
+void ZmqServer::reloadChangedFiles()
+{
+    if (m_changedFiles.isEmpty()) {
+        return;
+    }
+    
+    if (m_reloadInProgress) {
+        // Изменения будут подхвачены после завершения текущего разбора
+        return;
+    }
+    
+    const QStringList files(m_changedFiles.cbegin(), m_changedFiles.cend());
+    m_changedFiles.clear();
+    m_reloadInProgress = true;
+    
+    // Файл, замененный при сохранении, пропадает из наблюдения
+    for (const QString& file : files) {
+        if (!m_fileWatcher->files().contains(file) && QFileInfo::exists(file)) {
+            m_fileWatcher->addPath(file);
+        }
+    }
+    
+    // Разбор идет в пуле потоков, публикация в это время не останавливается
+    auto* watcher = new QFutureWatcher<QList<StudentStore>>(this);
+    connect(watcher, &QFutureWatcher<QList<StudentStore>>::finished, this, [this, watcher, files]() {
+        const QList<StudentStore> parsed = watcher->result();
+        for (qsizetype i = 0; i < files.size(); ++i) {
+            m_studentManager->reloadFile(files[i], parsed.value(i));
+        }
+        handOffRoster();
+        
+        watcher->deleteLater();
+        m_reloadInProgress = false;
+        
+        if (!m_changedFiles.isEmpty()) {
+            m_reloadTimer->start();
+        }
+    });
+    
+    watcher->setFuture(QtConcurrent::run([files]() {
+        StudentParser parser;
+        return parser.parseFiles(files);
+    }));
+}
+
+void ZmqServer::serveQueries()
+{
+    if (!m_querySocket) {
+        return;
+    }
+    
+    // ZMQ_FD сообщает только о смене состояния, а не о каждом сообщении,
+    // поэтому очередь вычитывается до конца, пока ZMQ_EVENTS видит входящие
+    try {
+        while (m_querySocket->get(zmq::sockopt::events) & ZMQ_POLLIN) {
+            std::vector<zmq::message_t> frames;
+            do {
+                frames.emplace_back();
+                if (!m_querySocket->recv(frames.back(), zmq::recv_flags::dontwait)) {
+                    frames.pop_back();
+                    break;
                 }
-            }
+            } while (frames.back().more());
             
-            for (int i = 0; i < 30 && m_running; ++i) {
-                QThread::msleep(100);
+            if (frames.size() >= 2) {
+                answerQuery(frames);
             }
-            
-        } catch (const zmq::error_t& e) {
-            if (m_running) {
-                qCritical() << "Error sending message:" << e.what();
-            }
-            break;
         }
+    } catch (const zmq::error_t& e) {
+        qCWarning(lcTransport) << "Error serving query:" << e.what();
+    }
+}
+
+void ZmqServer::answerQuery(std::vector<zmq::message_t>& frames)
+{
+    RosterMetrics::ScopedTimer timer(RosterMetrics::QueryTime);
+    
+    // Последний кадр - запрос; кадры перед ним - адрес отправителя (и пустой
+    // разделитель REQ), они возвращаются без изменений
+    const zmq::message_t& request = frames.back();
+    RosterProtocol::Query query;
+    RosterProtocol::QueryReply reply;
+    reply.version = m_studentManager->version();
+    QByteArray body;
+    
+    if (!RosterProtocol::decodeQuery(request.data<char>(), qsizetype(request.size()), query) ||
+        !m_studentManager->serializeQuery(query, body, reply.total)) {
+        reply.status = RosterProtocol::QueryMalformed;
+        RosterMetrics::add(RosterMetrics::QueryErrors);
+        qCDebug(lcTransport) << "Malformed query of" << request.size() << "bytes";
+    }
+    
+    const QByteArray header = RosterProtocol::encodeQueryReply(reply);
+    
+    for (size_t i = 0; i + 1 < frames.size(); ++i) {
+        m_querySocket->send(frames[i], zmq::send_flags::sndmore | zmq::send_flags::dontwait);
     }
+    m_querySocket->send(zmq::const_buffer(header.constData(), size_t(header.size())),
+                        zmq::send_flags::sndmore | zmq::send_flags::dontwait);
+    m_querySocket->send(zmq::const_buffer(body.constData(), size_t(body.size())), zmq::send_flags::dontwait);
     
-    qDebug() << "ZmqServer: sendStudents loop finished";
+    RosterMetrics::add(RosterMetrics::QueriesServed);
+    ROSTER_TRACE(lcTransport) << "Query type" << int(query.type) << "matched" << reply.total
+                              << "students, replied with" << body.size() << "bytes";
 }
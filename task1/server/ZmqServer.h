@@ -1,9 +1,15 @@
 #ifndef ZMQSERVER_H
 #define ZMQSERVER_H
 
+#include <QFileSystemWatcher>
 #include <QObject>
+#include <QSet>
+#include <QSocketNotifier>
 #include <QThread>
+#include <QTimer>
+#include <vector>
 #include <zmq.hpp>
+#include "RosterPublisher.h"
 #include "StudentManager.h"
 
 class ZmqServer : public QObject
@@ -17,16 +23,90 @@ public:
     void start();
     void stop();
     
-public slots:
-    void sendStudents();
+    // Общий контекст нужен для inproc; чужой контекст сервер не закрывает
+    void setContext(zmq::context_t* context) { m_context = context; m_ownsContext = false; }
+    
+    void addEndpoint(const QString& endpoint) { m_endpoints.append(endpoint); }
+    QStringList endpoints() const { return m_endpoints; }
+    
+    // Адреса сокета ROUTER для запросов (REQ/DEALER); без них запросы не обслуживаются
+    void addQueryEndpoint(const QString& endpoint) { m_queryEndpoints.append(endpoint); }
+    QStringList queryEndpoints() const { return m_queryEndpoints; }
+    
+    // Настройки публикации задаются до start
+    void setPublishInterval(int ms) { m_publisher->setPublishInterval(ms); }
+    int publishInterval() const { return m_publisher->publishInterval(); }
+    
+    void setSnapshotInterval(int ticks) { m_publisher->setSnapshotInterval(ticks); }
+    int snapshotInterval() const { return m_publisher->snapshotInterval(); }
+    
+    void setStringTableEnabled(bool enabled) { m_studentManager->setStringTableEnabled(enabled); }
+    void setCompressionEnabled(bool enabled) { m_studentManager->setCompressionEnabled(enabled); }
+    void setPresortEnabled(bool enabled) { m_studentManager->setPresortEnabled(enabled); }
+    
+    // Поиск почти дубликатов после изменений списка: группы студентов, отличающихся
+    // не больше чем на edits правок, пишутся в журнал. 0 - выключен
+    void setNearDuplicateEdits(int edits) { m_nearDuplicateEdits = qMax(0, edits); }
+    int nearDuplicateEdits() const { return m_nearDuplicateEdits; }
+    
+    void setChunkSize(qsizetype bytes) { m_studentManager->setChunkSize(bytes); }
+    void setPartitionCount(quint32 count) { m_studentManager->setPartitionCount(count); }
+    
+    void setInputFiles(const QStringList& files) { m_inputFiles = files; }
+    QStringList inputFiles() const { return m_inputFiles; }
+    
+    // Заменяет вклад файла без чтения с диска и сразу публикует изменения;
+    // возвращает новую версию списка
+    quint64 updateFile(const QString& filename, const StudentStore& students);
+    quint64 rosterVersion() const { return m_studentManager->version(); }
+    
+    // Поток, в котором работает издатель (для замеров)
+    QThread* publisherThread() const { return m_workerThread; }
+
+signals:
+    void rosterChanged();
+
+private slots:
+    void onInputFileChanged(const QString& path);
+    void reloadChangedFiles();
+    void serveQueries();
+    void captureSnapshotSource();
+    void findNearDuplicates();
 
 private:
-    QString m_endpoint;
+    void handOffRoster();
+    bool startQueries();
+    void answerQuery(std::vector<zmq::message_t>& frames);
+    void reportNearDuplicates(const QList<QStringList>& clusters);
+    
+    QStringList m_endpoints;
     zmq::context_t* m_context;
-    zmq::socket_t* m_socket;
+    bool m_ownsContext;
     StudentManager* m_studentManager;
     QThread* m_workerThread;
+    RosterPublisher* m_publisher;
     bool m_running;
+    
+    // Запросы обслуживаются в основном потоке: индексы и хранилище принадлежат ему
+    QStringList m_queryEndpoints;
+    zmq::socket_t* m_querySocket;
+    QSocketNotifier* m_queryNotifier;
+    
+    // Последнее переданное потоку публикации состояние без копии списка (только основной поток)
+    RosterStatePtr m_handedOff;
+    
+    QStringList m_inputFiles;
+    QFileSystemWatcher* m_fileWatcher;
+    QTimer* m_reloadTimer;
+    QSet<QString> m_changedFiles;
+    bool m_reloadInProgress;
+    
+    // Поиск идет в пуле потоков по копии списка и не чаще раза в интервал
+    // таймера; в журнал попадают только группы, которых не было в прошлый раз
+    int m_nearDuplicateEdits;
+    QTimer* m_nearDuplicateTimer;
+    bool m_nearDuplicateRunning;
+    QSet<QString> m_reportedClusters;
 };
 
 #endif // ZMQSERVER_H
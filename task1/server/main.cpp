@@ -1,6 +1,8 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QLoggingCategory>
+#include "RosterMetrics.h"
 #include "ZmqServer.h"
 
 int main(int argc, char *argv[])
@@ -16,16 +18,125 @@ int main(int argc, char *argv[])
     
     QCommandLineOption endpointOption(
         {"e", "endpoint"},
-        "ZMQ endpoint to bind to",
+        "ZMQ endpoint to bind to (may be repeated)",
         "endpoint",
         "tcp://*:5555"
     );
     parser.addOption(endpointOption);
+    
+    QCommandLineOption queryEndpointOption(
+        {"q", "query-endpoint"},
+        "ZMQ endpoint for student queries (may be repeated, off by default)",
+        "endpoint"
+    );
+    parser.addOption(queryEndpointOption);
+    
+    QCommandLineOption publishIntervalOption(
+        "publish-interval",
+        "Publish timer tick in milliseconds",
+        "ms",
+        "3000"
+    );
+    parser.addOption(publishIntervalOption);
+    
+    QCommandLineOption snapshotIntervalOption(
+        {"s", "snapshot-interval"},
+        "Send a full snapshot every N publish ticks, deltas in between",
+        "ticks",
+        "1"
+    );
+    parser.addOption(snapshotIntervalOption);
+    
+    QCommandLineOption stringTableOption(
+        "string-table",
+        "Encode repeated names through a shared string table"
+    );
+    parser.addOption(stringTableOption);
+    
+    QCommandLineOption compressOption(
+        {"z", "compress"},
+        "Compress published rosters (zlib), once per roster version"
+    );
+    parser.addOption(compressOption);
+    
+    QCommandLineOption noPresortOption(
+        "no-presort",
+        "Publish snapshots in storage order and leave sorting to clients"
+    );
+    parser.addOption(noPresortOption);
+    
+    QCommandLineOption nearDuplicatesOption(
+        "near-duplicates",
+        "Log groups of students that differ by at most the given number of edits (0 disables)",
+        "edits",
+        "0"
+    );
+    parser.addOption(nearDuplicatesOption);
+    
+    QCommandLineOption chunkSizeOption(
+        {"c", "chunk-size"},
+        "Maximum size of one published chunk in KiB",
+        "kib",
+        "256"
+    );
+    parser.addOption(chunkSizeOption);
+    
+    QCommandLineOption partitionsOption(
+        {"p", "partitions"},
+        "Split the roster into N topic partitions by last name",
+        "count",
+        "1"
+    );
+    parser.addOption(partitionsOption);
+    
+    QCommandLineOption logRulesOption(
+        "log-rules",
+        "Logging rules, e.g. \"roster.transport.debug=true;roster.codec.debug=true\"",
+        "rules"
+    );
+    parser.addOption(logRulesOption);
+    
+    QCommandLineOption statsOption(
+        "stats",
+        "Append a JSON line with metrics to the file periodically (\"-\" for stdout)",
+        "file"
+    );
+    parser.addOption(statsOption);
+    
+    QCommandLineOption statsIntervalOption(
+        "stats-interval",
+        "Metrics dump interval in milliseconds",
+        "ms",
+        "10000"
+    );
+    parser.addOption(statsIntervalOption);
     parser.process(app);
     
-    QString endpoint = parser.value(endpointOption);
+    if (parser.isSet(logRulesOption)) {
+        QLoggingCategory::setFilterRules(parser.value(logRulesOption).replace(';', '\n'));
+    }
+    
+    if (parser.isSet(statsOption)) {
+        new MetricsDumper("server", parser.value(statsOption), parser.value(statsIntervalOption).toInt(), &app);
+    }
+    
+    const QStringList endpoints = parser.values(endpointOption);
     
-    ZmqServer server(endpoint);
+    ZmqServer server(endpoints.value(0, "tcp://*:5555"));
+    for (qsizetype i = 1; i < endpoints.size(); ++i) {
+        server.addEndpoint(endpoints[i]);
+    }
+    for (const QString& endpoint : parser.values(queryEndpointOption)) {
+        server.addQueryEndpoint(endpoint);
+    }
+    server.setPublishInterval(parser.value(publishIntervalOption).toInt());
+    server.setSnapshotInterval(parser.value(snapshotIntervalOption).toInt());
+    server.setStringTableEnabled(parser.isSet(stringTableOption));
+    server.setCompressionEnabled(parser.isSet(compressOption));
+    server.setPresortEnabled(!parser.isSet(noPresortOption));
+    server.setNearDuplicateEdits(parser.value(nearDuplicatesOption).toInt());
+    server.setChunkSize(qMax(1, parser.value(chunkSizeOption).toInt()) * 1024);
+    server.setPartitionCount(quint32(qMax(1, parser.value(partitionsOption).toInt())));
     server.start();
     
     qDebug() << "Server running. Press Ctrl+C to stop.";
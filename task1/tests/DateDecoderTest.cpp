@@ -0,0 +1,67 @@
+#include <QDate>
+#include <QTest>
+#include "DateDecoder.h"
+
+class DateDecoderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void decode_data();
+    void decode();
+    void decodeColumn();
+};
+
+void DateDecoderTest::decode_data()
+{
+    QTest::addColumn<QByteArray>("text");
+    QTest::addColumn<qint64>("expected");
+    
+    const qint64 invalid = DateDecoder::InvalidDay;
+    QTest::newRow("dd.MM.yyyy") << QByteArray("01.01.1988") << QDate(1988, 1, 1).toJulianDay();
+    QTest::newRow("d.M.yyyy") << QByteArray("1.1.1988") << QDate(1988, 1, 1).toJulianDay();
+    QTest::newRow("d.MM.yyyy") << QByteArray("7.12.2003") << QDate(2003, 12, 7).toJulianDay();
+    QTest::newRow("dd.M.yyyy") << QByteArray("31.3.1999") << QDate(1999, 3, 31).toJulianDay();
+    QTest::newRow("leap day") << QByteArray("29.02.2000") << QDate(2000, 2, 29).toJulianDay();
+    QTest::newRow("not a leap year") << QByteArray("29.02.1900") << invalid;
+    QTest::newRow("day out of month") << QByteArray("31.04.2000") << invalid;
+    QTest::newRow("month 13") << QByteArray("01.13.2000") << invalid;
+    QTest::newRow("day 0") << QByteArray("00.01.2000") << invalid;
+    QTest::newRow("bad day separator") << QByteArray("01x01.1988") << invalid;
+    QTest::newRow("bad short day separator") << QByteArray("1x1.1988") << invalid;
+    QTest::newRow("bad month separator") << QByteArray("01.01x1988") << invalid;
+    QTest::newRow("bad short month separator") << QByteArray("1.1x1988") << invalid;
+    QTest::newRow("dash month separator") << QByteArray("12.12-2000") << invalid;
+    QTest::newRow("five-digit year") << QByteArray("1.1.19889") << invalid;
+    QTest::newRow("letter in year") << QByteArray("01.01.19a8") << invalid;
+    QTest::newRow("too short") << QByteArray("1.1.198") << invalid;
+    QTest::newRow("empty") << QByteArray() << invalid;
+}
+
+void DateDecoderTest::decode()
+{
+    QFETCH(QByteArray, text);
+    QFETCH(qint64, expected);
+    
+    QCOMPARE(DateDecoder::decode(text), expected);
+}
+
+void DateDecoderTest::decodeColumn()
+{
+    const QList<QByteArray> texts = {"01.01.1988", "01.01x1988", "12.12-2000", "5.6.2010"};
+    QList<QByteArrayView> fields;
+    for (const QByteArray& text : texts) {
+        fields.append(text);
+    }
+    QList<qint64> days(fields.size());
+    
+    DateDecoder::decodeColumn(fields.constData(), fields.size(), days.data());
+    
+    for (qsizetype i = 0; i < fields.size(); ++i) {
+        QCOMPARE(days[i], DateDecoder::decode(fields[i]));
+    }
+    QCOMPARE(days[3], QDate(2010, 6, 5).toJulianDay());
+}
+
+QTEST_APPLESS_MAIN(DateDecoderTest)
+#include "DateDecoderTest.moc"
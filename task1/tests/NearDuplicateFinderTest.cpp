@@ -0,0 +1,108 @@
+#include <QDate>
+#include <QTest>
+#include <algorithm>
+#include "NearDuplicateFinder.h"
+#include "StudentStore.h"
+
+namespace {
+
+StudentRow row(const char* lastName, const char* firstName, const char* middleName, QDate birthDate)
+{
+    StudentRow student;
+    student.id = 1;
+    student.lastName = lastName;
+    student.firstName = firstName;
+    student.middleName = middleName;
+    student.julianDay = qint32(birthDate.toJulianDay());
+    return student;
+}
+
+QList<QList<quint32>> sortedClusters(NearDuplicateFinder& finder)
+{
+    QList<QList<quint32>> clusters = finder.clusters();
+    for (QList<quint32>& cluster : clusters) {
+        std::sort(cluster.begin(), cluster.end());
+    }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+}
+
+} // namespace
+
+class NearDuplicateFinderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void editDistance_data();
+    void editDistance();
+    void clusters_data();
+    void clusters();
+};
+
+void NearDuplicateFinderTest::editDistance_data()
+{
+    QTest::addColumn<QString>("left");
+    QTest::addColumn<QString>("right");
+    QTest::addColumn<int>("limit");
+    QTest::addColumn<int>("expected");
+    
+    QTest::newRow("equal") << QString("иванов") << QString("иванов") << 1 << 0;
+    QTest::newRow("substitution") << QString("петров") << QString("петроф") << 1 << 1;
+    QTest::newRow("insertion") << QString("иванов") << QString("ивванов") << 1 << 1;
+    QTest::newRow("over limit") << QString("смирнов") << QString("смирнова") << 0 << 1;
+    QTest::newRow("length over limit") << QString("ли") << QString("лиментьев") << 2 << 3;
+}
+
+void NearDuplicateFinderTest::editDistance()
+{
+    QFETCH(QString, left);
+    QFETCH(QString, right);
+    QFETCH(int, limit);
+    QFETCH(int, expected);
+    
+    QCOMPARE(NearDuplicateFinder::editDistance(left, right, limit), expected);
+    QCOMPARE(NearDuplicateFinder::editDistance(right, left, limit), expected);
+}
+
+void NearDuplicateFinderTest::clusters_data()
+{
+    QTest::addColumn<int>("edits");
+    QTest::addColumn<QList<QList<quint32>>>("expected");
+    
+    QTest::newRow("exact only") << 0 << QList<QList<quint32>>();
+    QTest::newRow("one edit") << 1 << QList<QList<quint32>>({{1, 2}, {3, 4}, {5, 6}, {7, 8}});
+    // Две правки: ошибки в дне и в месяце рождения
+    QTest::newRow("two edits") << 2 << QList<QList<quint32>>({{1, 2, 9}, {3, 4}, {5, 6}, {7, 8}});
+}
+
+void NearDuplicateFinderTest::clusters()
+{
+    QFETCH(int, edits);
+    QFETCH(QList<QList<quint32>>, expected);
+    
+    NearDuplicateFinder finder(edits);
+    // Опечатка в месяце
+    finder.add(1, row("Иванов", "Иван", "Иванович", QDate(1989, 10, 11)));
+    finder.add(2, row("Иванов", "Иван", "Иванович", QDate(1989, 11, 11)));
+    // Опечатка в фамилии, регистр и "ё" не различаются
+    finder.add(3, row("Петров", "Пётр", "", QDate(1990, 1, 1)));
+    finder.add(4, row("ПЕТРОФ", "Петр", "", QDate(1990, 1, 1)));
+    // Переставлены день и месяц
+    finder.add(5, row("Кузнецов", "Олег", "", QDate(1992, 4, 3)));
+    finder.add(6, row("Кузнецов", "Олег", "", QDate(1992, 3, 4)));
+    // Опечатка в отчестве
+    finder.add(7, row("Смирнова", "Анна", "Сергеевна", QDate(1991, 2, 3)));
+    finder.add(8, row("Смирнова", "Анна", "Сергеевнa", QDate(1991, 2, 3)));
+    // Две ошибки в дате
+    finder.add(9, row("Иванов", "Иван", "Иванович", QDate(1989, 12, 12)));
+    // Разные люди с общим ключом блока
+    finder.add(10, row("Смирнова", "Мария", "Сергеевна", QDate(1991, 2, 3)));
+    finder.add(11, row("Сидоров", "Сидор", "", QDate(1993, 5, 5)));
+    
+    QCOMPARE(sortedClusters(finder), expected);
+}
+
+QTEST_APPLESS_MAIN(NearDuplicateFinderTest)
+
+#include "NearDuplicateFinderTest.moc"
@@ -0,0 +1,167 @@
+#include <QDate>
+#include <QMap>
+#include <QTest>
+#include <algorithm>
+#include <tuple>
+#include "RosterReplica.h"
+
+namespace {
+
+struct Row
+{
+    quint32 key;
+    qint32 id;
+    QByteArray firstName;
+    QByteArray middleName;
+    QByteArray lastName;
+    qint32 julianDay;
+};
+
+qint32 day(int year, int month, int dayOfMonth)
+{
+    return qint32(QDate(year, month, dayOfMonth).toJulianDay());
+}
+
+// Снимок в порядке сервера: ФИО по байтам UTF-8, при совпадении - ключ
+RosterBufferPtr snapshotOf(QMap<quint32, Row> roster, bool sorted)
+{
+    QList<Row> rows = roster.values();
+    if (sorted) {
+        std::sort(rows.begin(), rows.end(), [](const Row& left, const Row& right) {
+            return std::tie(left.lastName, left.firstName, left.middleName, left.key) <
+                   std::tie(right.lastName, right.firstName, right.middleName, right.key);
+        });
+    }
+    
+    RosterWriter writer(RosterProtocol::SnapshotMessage);
+    writer.setSorted(sorted);
+    for (const Row& row : std::as_const(rows)) {
+        writer.addUpsert(row.key, row.id, row.firstName, row.middleName, row.lastName, row.julianDay);
+    }
+    return RosterBuffer::fromBytes(writer.finish().value(0), 0, RosterProtocol::SnapshotMessage);
+}
+
+} // namespace
+
+class RosterReplicaTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void deltaMatchesSnapshot_data();
+    void deltaMatchesSnapshot();
+    void deltaBuffersReleased();
+
+private:
+    static void compareReplicas(const RosterReplica& actual, const RosterReplica& expected);
+};
+
+void RosterReplicaTest::compareReplicas(const RosterReplica& actual, const RosterReplica& expected)
+{
+    QCOMPARE(actual.isOrdered(), expected.isOrdered());
+    QCOMPARE(actual.order(), expected.order());
+    QCOMPARE(actual.size(), expected.size());
+    
+    for (auto it = expected.records().cbegin(); it != expected.records().cend(); ++it) {
+        QVERIFY2(actual.records().contains(it.key()), QByteArray::number(it.key()).constData());
+        const RosterRecordView left = actual.records().value(it.key()).decode();
+        const RosterRecordView right = it->decode();
+        QCOMPARE(left.id, right.id);
+        QCOMPARE(left.firstName.toByteArray(), right.firstName.toByteArray());
+        QCOMPARE(left.middleName.toByteArray(), right.middleName.toByteArray());
+        QCOMPARE(left.lastName.toByteArray(), right.lastName.toByteArray());
+        QCOMPARE(left.julianDay, right.julianDay);
+    }
+}
+
+void RosterReplicaTest::deltaMatchesSnapshot_data()
+{
+    QTest::addColumn<bool>("sorted");
+    
+    QTest::newRow("sorted snapshot") << true;
+    QTest::newRow("unsorted snapshot") << false;
+}
+
+void RosterReplicaTest::deltaMatchesSnapshot()
+{
+    QFETCH(bool, sorted);
+    
+    QMap<quint32, Row> roster;
+    roster.insert(1, {1, 10, "Иван", "Иванович", "Иванов", day(1990, 5, 1)});
+    roster.insert(2, {2, 11, "Петр", "", "Петров", day(1989, 10, 11)});
+    roster.insert(3, {3, 12, "Анна", "Сергеевна", "Смирнова", day(1991, 2, 3)});
+    roster.insert(4, {4, 13, "Иван", "Иванович", "Иванов", day(1992, 7, 8)});
+    roster.insert(5, {5, 14, "Мария", "", "Кузнецова", day(1993, 1, 20)});
+    
+    RosterReplica replica;
+    QVERIFY(replica.apply(snapshotOf(roster, sorted), RosterProtocol::SnapshotMessage));
+    
+    // Удаления, новые ключи в начале, середине и конце порядка, смена id,
+    // ключ, удаленный и добавленный заново, и ключ, добавленный и удаленный одной дельтой
+    RosterWriter writer(RosterProtocol::DeltaMessage);
+    const auto upsert = [&](const Row& row) {
+        writer.addUpsert(row.key, row.id, row.firstName, row.middleName, row.lastName, row.julianDay);
+        roster.insert(row.key, row);
+    };
+    const auto remove = [&](quint32 key) {
+        writer.addRemove(key);
+        roster.remove(key);
+    };
+    
+    remove(2);
+    upsert({6, 15, "Борис", "", "Абрамов", day(1988, 3, 4)});
+    upsert({7, 16, "Иван", "Иванович", "Иванов", day(1994, 6, 6)});
+    upsert({8, 17, "Юрий", "", "Яковлев", day(1995, 9, 9)});
+    upsert({5, 24, "Мария", "", "Кузнецова", day(1993, 1, 20)});
+    remove(3);
+    upsert({3, 18, "Олег", "", "Ершов", day(1996, 4, 12)});
+    upsert({9, 19, "Вера", "", "Лебедева", day(1997, 8, 30)});
+    remove(9);
+    remove(42);
+    
+    QVERIFY(replica.apply(RosterBuffer::fromBytes(writer.finish().value(0), 0, RosterProtocol::DeltaMessage),
+                          RosterProtocol::DeltaMessage));
+    
+    RosterReplica expected;
+    QVERIFY(expected.apply(snapshotOf(roster, sorted), RosterProtocol::SnapshotMessage));
+    
+    compareReplicas(replica, expected);
+    if (sorted) {
+        QCOMPARE(replica.order(), QList<quint32>({6, 3, 1, 4, 7, 5, 8}));
+    }
+}
+
+void RosterReplicaTest::deltaBuffersReleased()
+{
+    QMap<quint32, Row> roster;
+    roster.insert(1, {1, 10, "Иван", "Иванович", "Иванов", day(1990, 5, 1)});
+    roster.insert(2, {2, 11, "Петр", "", "Петров", day(1989, 10, 11)});
+    
+    RosterReplica replica;
+    QVERIFY(replica.apply(snapshotOf(roster, true), RosterProtocol::SnapshotMessage));
+    const RosterBufferPtr snapshot = replica.buffers().value(0);
+    
+    // Каждая дельта перезаписывает один и тот же ключ; тела снимка закреплены
+    for (qint32 id = 100; id < 200; ++id) {
+        RosterWriter writer(RosterProtocol::DeltaMessage);
+        writer.addUpsert(1, id, "Иван", "Иванович", "Иванов", day(1990, 5, 1));
+        QVERIFY(replica.apply(RosterBuffer::fromBytes(writer.finish().value(0), 0, RosterProtocol::DeltaMessage),
+                              RosterProtocol::DeltaMessage));
+        QCOMPARE(replica.buffers().size(), qsizetype(2));
+        QCOMPARE(replica.records().value(1).decode().id, id);
+    }
+    QCOMPARE(replica.snapshotBuffers(), qsizetype(1));
+    QCOMPARE(replica.buffers().value(0), snapshot);
+    
+    // Тело, записи которого удалены, отпускается вместе с последней
+    RosterWriter writer(RosterProtocol::DeltaMessage);
+    writer.addRemove(1);
+    QVERIFY(replica.apply(RosterBuffer::fromBytes(writer.finish().value(0), 0, RosterProtocol::DeltaMessage),
+                          RosterProtocol::DeltaMessage));
+    QCOMPARE(replica.buffers().size(), qsizetype(1));
+    QCOMPARE(replica.order(), QList<quint32>({2}));
+}
+
+QTEST_APPLESS_MAIN(RosterReplicaTest)
+
+#include "RosterReplicaTest.moc"
@@ -0,0 +1,168 @@
+#include <QDate>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <memory>
+#include <zmq.hpp>
+#include "RosterCache.h"
+#include "ZmqClient.h"
+
+namespace {
+
+const char kEndpoint[] = "inproc://roster-cache-test";
+
+QByteArray snapshotBody(quint32 key, const QByteArray& lastName)
+{
+    RosterWriter writer(RosterProtocol::SnapshotMessage);
+    writer.setSorted(true);
+    writer.addUpsert(key, qint32(key), "Иван", "", lastName, qint32(QDate(1990, 1, 1).toJulianDay()));
+    return writer.finish().value(0);
+}
+
+RosterCache::Partition cachedPartition(quint32 index, quint64 epoch, quint64 version, const QByteArray& lastName)
+{
+    RosterCache::Partition partition;
+    partition.index = index;
+    partition.epoch = epoch;
+    partition.version = version;
+    partition.bodies.append(RosterBuffer::fromBytes(snapshotBody(index + 1, lastName), 0,
+                                                    RosterProtocol::SnapshotMessage));
+    return partition;
+}
+
+QList<QByteArray> lastNames(const RosterView& roster)
+{
+    QList<QByteArray> names;
+    for (const RosterView::Record& record : roster) {
+        names.append(record.lastNameUtf8().toByteArray());
+    }
+    return names;
+}
+
+// Сервер, который раз в 20 мс рассылает снимок одного раздела
+class SnapshotSender
+{
+public:
+    SnapshotSender(zmq::context_t& context, quint32 partition, quint64 epoch, quint64 version,
+                   const QByteArray& lastName)
+        : m_socket(context, ZMQ_PUB)
+        , m_body(snapshotBody(partition + 1, lastName))
+    {
+        m_envelope.type = RosterProtocol::SnapshotMessage;
+        m_envelope.partition = partition;
+        m_envelope.epoch = epoch;
+        m_envelope.version = version;
+        m_socket.set(zmq::sockopt::linger, 0);
+        m_socket.bind(kEndpoint);
+        
+        // Подписчик подключается не сразу, поэтому снимок повторяется
+        m_timer.setInterval(20);
+        QObject::connect(&m_timer, &QTimer::timeout, [this]() { send(); });
+        m_timer.start();
+    }
+
+private:
+    void send()
+    {
+        ++m_envelope.sequence;
+        const QByteArray topic = RosterProtocol::topic(m_envelope.partition);
+        const QByteArray header = RosterProtocol::encodeEnvelope(m_envelope);
+        m_socket.send(zmq::const_buffer(topic.constData(), size_t(topic.size())), zmq::send_flags::sndmore);
+        m_socket.send(zmq::const_buffer(header.constData(), size_t(header.size())), zmq::send_flags::sndmore);
+        m_socket.send(zmq::const_buffer(m_body.constData(), size_t(m_body.size())), zmq::send_flags::none);
+    }
+    
+    zmq::socket_t m_socket;
+    QByteArray m_body;
+    RosterProtocol::Envelope m_envelope;
+    QTimer m_timer;
+};
+
+} // namespace
+
+class ZmqClientCacheTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void sameEpochConfirmsCache();
+    void restartedServerReplacesCache();
+    void unpublishedPartitionExpires();
+
+private:
+    std::unique_ptr<QTemporaryDir> m_dir;
+    QString m_cacheFile;
+};
+
+void ZmqClientCacheTest::init()
+{
+    m_dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(m_dir->isValid());
+    m_cacheFile = m_dir->filePath("roster.cache");
+}
+
+void ZmqClientCacheTest::sameEpochConfirmsCache()
+{
+    QVERIFY(RosterCache::save(m_cacheFile, {cachedPartition(0, 1, 5, "Иванов")}));
+    
+    zmq::context_t context(1);
+    // Другое содержимое той же эпохи и версии не декодируется: кэш подтвержден
+    SnapshotSender sender(context, 0, 1, 5, "Петров");
+    
+    ZmqClient client(kEndpoint);
+    client.setContext(&context);
+    client.setCacheFile(m_cacheFile);
+    RosterView roster;
+    connect(&client, &ZmqClient::rosterUpdated, this, [&roster](const RosterView& view) { roster = view; });
+    client.start();
+    
+    QCOMPARE(lastNames(roster), QList<QByteArray>({"Иванов"}));
+    QTRY_VERIFY(client.receiveStats().messages >= 2);
+    QCOMPARE(lastNames(roster), QList<QByteArray>({"Иванов"}));
+    client.stop();
+}
+
+void ZmqClientCacheTest::restartedServerReplacesCache()
+{
+    QVERIFY(RosterCache::save(m_cacheFile, {cachedPartition(0, 1, 5, "Иванов")}));
+    
+    zmq::context_t context(1);
+    // Перезапущенный сервер дошел до той же версии с другим списком
+    SnapshotSender sender(context, 0, 2, 5, "Петров");
+    
+    ZmqClient client(kEndpoint);
+    client.setContext(&context);
+    client.setCacheFile(m_cacheFile);
+    RosterView roster;
+    connect(&client, &ZmqClient::rosterUpdated, this, [&roster](const RosterView& view) { roster = view; });
+    client.start();
+    
+    QCOMPARE(lastNames(roster), QList<QByteArray>({"Иванов"}));
+    QTRY_COMPARE(lastNames(roster), QList<QByteArray>({"Петров"}));
+    client.stop();
+}
+
+void ZmqClientCacheTest::unpublishedPartitionExpires()
+{
+    QVERIFY(RosterCache::save(m_cacheFile, {cachedPartition(0, 1, 5, "Иванов"), cachedPartition(1, 1, 5, "Петров")}));
+    
+    zmq::context_t context(1);
+    // Раздел 1 сервер больше не публикует
+    SnapshotSender sender(context, 0, 1, 5, "Иванов");
+    
+    ZmqClient client(kEndpoint);
+    client.setContext(&context);
+    client.setCacheFile(m_cacheFile);
+    RosterView roster;
+    connect(&client, &ZmqClient::rosterUpdated, this, [&roster](const RosterView& view) { roster = view; });
+    client.start();
+    
+    QCOMPARE(lastNames(roster), QList<QByteArray>({"Иванов", "Петров"}));
+    QTRY_COMPARE(lastNames(roster), QList<QByteArray>({"Иванов"}));
+    client.stop();
+}
+
+QTEST_GUILESS_MAIN(ZmqClientCacheTest)
+
+#include "ZmqClientCacheTest.moc"